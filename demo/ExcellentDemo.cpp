@@ -32,25 +32,41 @@ void ExcellentDemo::Render(Canvas& canvas, uint32_t timeMs)
     lastStepTime = now;
     float burnDist = burnProgress.step(dt);
     
-    // Draw text to temp canvas
+    // Draw text to a temp canvas that only covers the text and its outline
+    const int outline = 2;
+    Point center(canvas.Width() / 2, canvas.Height() / 2);
+    Rect textRect = text.GetTextRect(center);
+    int left = std::max(textRect.x - outline, 0);
+    int top = std::max(textRect.y - outline, 0);
+    int right = std::min(textRect.x + textRect.width + outline, canvas.Width());
+    int bottom = std::min(textRect.y + textRect.height + outline, canvas.Height());
+    if ((right <= left) || (bottom <= top)) return;
+    Point origin(left, top);
+    if ((tempCanvas.Width() != right - left) || (tempCanvas.Height() != bottom - top))
+        tempCanvas.Resize(right - left, bottom - top);
     tempCanvas.Clear(Color(0, 0, 0, 0));
-    text.DrawOutlineMask(tempCanvas, Point(DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2), 2, BLACK);
-    text.DrawMask(tempCanvas, Point(DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2), WHITE);
+    Point localCenter(center.x - origin.x, center.y - origin.y);
+    text.DrawOutlineMask(tempCanvas, localCenter, outline, BLACK);
+    text.DrawMask(tempCanvas, localCenter, WHITE);
     
     // Apply burning effect - turn white pixels into glowy fire
     float timeSec = static_cast<float>(ch::ToMilliseconds(now - startTime)) / 3000.0f;
-    float scaleX = 1.0f / static_cast<float>(DISPLAY_WIDTH * 0.5f);
-    float scaleY = 1.0f / static_cast<float>(DISPLAY_HEIGHT);
+    float scaleX = 1.0f / static_cast<float>(canvas.Width() * 0.5f);
+    float scaleY = 1.0f / static_cast<float>(canvas.Height());
     Size canvasSize = tempCanvas.GetSize();
     float burnColorsWidthF = static_cast<float>(burnColors.Width() - 1);
     
     for (int y = 0; y < canvasSize.height; y++) {
         for (int x = 0; x < canvasSize.width; x++) {
-            Color tc = tempCanvas.GetPixel(x, y);
+            Color tc = tempCanvas.GetPixelStraight(x, y);
             if (tc.a > 0) {
+                // Burn map, texture and shader work in screen coordinates
+                int sx = origin.x + x;
+                int sy = origin.y + y;
+                
                 // Get burn map value and texture
-                float bm = 1.0f - static_cast<float>(burnMap.GetByte(x, y)) / 255.0f;
-                byte bt = burnTex.GetByte(x, y);
+                float bm = 1.0f - static_cast<float>(burnMap.GetByte(sx, sy)) / 255.0f;
+                byte bt = burnTex.GetByte(sx, sy);
                 
                 // Calculate edge position and glow
                 float edgePos = std::clamp((burnDist + bm) - 1.0f, -BURN_LENGTH, 0.0f) + BURN_LENGTH;
@@ -65,8 +81,8 @@ void ExcellentDemo::Render(Canvas& canvas, uint32_t timeMs)
                     );
                     
                     // Apply fire shader
-                    float u = static_cast<float>(x) * scaleX;
-                    float v = static_cast<float>(y) * scaleY;
+                    float u = static_cast<float>(sx) * scaleX;
+                    float v = static_cast<float>(sy) * scaleY;
                     c = FireShader(u, v, timeSec);
                     
                     // Modulate with burn texture and original alpha
@@ -77,10 +93,10 @@ void ExcellentDemo::Render(Canvas& canvas, uint32_t timeMs)
                     c = Color(0, 0, 0, 0);
                 }
                 
-                tempCanvas.SetPixel(x, y, c);
+                tempCanvas.SetPixelStraight(x, y, c);
             }
         }
     }
     
-    canvas.DrawColorImageMask(Point(0, 0), tempCanvas);
+    canvas.DrawColorImageMask(origin, tempCanvas);
 }
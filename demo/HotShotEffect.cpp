@@ -45,13 +45,13 @@ void HotShotEffect::Render(Canvas& canvas, uint32_t timeMs)
     int w2 = text2.GetTextSize().width;
     int gap = 8;
     int totalW = w1 + gap + w2;
-    int startX = (DISPLAY_WIDTH - totalW) / 2;
+    int startX = (canvas.Width() - totalW) / 2;
     
     int t1_x_end = startX;
     int t2_x_end = startX + totalW; // Right aligned text
     
     int t1_x_start = -w1 - 10;
-    int t2_x_start = DISPLAY_WIDTH + w2 + 10;
+    int t2_x_start = canvas.Width() + w2 + 10;
     
     int t1_x = t1_x_end;
     int t2_x = t2_x_end;
@@ -75,34 +75,32 @@ void HotShotEffect::Render(Canvas& canvas, uint32_t timeMs)
         t2_x = t2[0];
     }
     
-    maskCanvas.Clear(Color(0,0,0,0));
-    text1.DrawOpaque(maskCanvas, Point(t1_x, 15), Color(255,255,255));
-    text2.DrawOpaque(maskCanvas, Point(t2_x, 15), Color(255,255,255));
+    if ((mask.Width() != canvas.Width()) || (mask.Height() != canvas.Height()))
+        mask.Resize(canvas.Width(), canvas.Height());
+    else
+        mask.Clear();
+    text1.Draw(mask, Point(t1_x, 15));
+    text2.Draw(mask, Point(t2_x, 15));
     
     float timesec = timeMs / 1000.0f;
-    for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
-        for (int x = 0; x < DISPLAY_WIDTH; ++x) {
-            Color m = maskCanvas.GetPixel(x, y);
-            if (m.r > 0) {
-                 float u = x / (float)DISPLAY_WIDTH;
-                 float v = y / (float)DISPLAY_HEIGHT;
-                 Color fire = FireShader(u, v, timesec);
-                 canvas.SetPixel(x, y, fire);
-                 
-                 if (elapsed > 500 && (rand() % 100) < 5) {
-                     SimpleParticle p;
-                     p.pos = glm::vec2(x, y);
-                     p.vel = glm::vec2(
-                         ((rand() % 100) / 100.0f - 0.5f) * 0.5f,
-                         -0.2f - ((rand() % 100) / 100.0f) * 0.2f
-                     );
-                     p.life = 1.0f;
-                     p.color = fire;
-                     particles.push_back(p);
-                 }
-            }
+    mask.ForEachPixel([&](int x, int y) {
+        float u = x / (float)canvas.Width();
+        float v = y / (float)canvas.Height();
+        Color fire = FireShader(u, v, timesec);
+        canvas.SetPixel(x, y, fire);
+        
+        if (elapsed > 500 && (rand() % 100) < 5) {
+            SimpleParticle p;
+            p.pos = glm::vec2(x, y);
+            p.vel = glm::vec2(
+                ((rand() % 100) / 100.0f - 0.5f) * 0.5f,
+                -0.2f - ((rand() % 100) / 100.0f) * 0.2f
+            );
+            p.life = 1.0f;
+            p.color = fire;
+            particles.push_back(p);
         }
-    }
+    });
     
     for (auto it = particles.begin(); it != particles.end(); ) {
         it->pos += it->vel;
@@ -18,7 +18,7 @@ private:
     const Font& font;
     Text text1;
     Text text2;
-    Canvas maskCanvas;
+    BitMask mask;
     
     uint32_t startTime;
     bool started;
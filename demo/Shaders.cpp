@@ -1,5 +1,6 @@
 #include "Shaders.h"
 #include "Voronoi.h"
+#include <algorithm>
 #include <cmath>
 #include <core/GraphicsConstants.h>
 #include <glm/common.hpp>
@@ -16,48 +17,49 @@ using namespace libled;
 // Sine Ripple Shader
 // ============================================================================
 
-Color SineShader(float u, float v, float time) {
-  // Convert to centered coordinates
-  glm::vec2 uv(u * 2.0f - 1.0f, v * 2.0f - 1.0f);
-
-  // Aspect ratio correction
-  float aspect = (float)DISPLAY_WIDTH / (float)DISPLAY_HEIGHT;
-  if (aspect > 1.0f) {
-    uv.x *= aspect;
-  } else {
-    uv.y /= aspect;
-  }
-
-  // Animated time
+void SineShader(const ShaderRow &row, float time) {
+  // Animated time, the same for the whole row
   float t = -time * 3.0f + 5000.0f + std::sin(time / 3.0f) * 5.0f;
-
-  // Distance from center - reduced scaling to extend further
-  float dist = glm::length(uv) * 0.35f;
   float maxDist = 1.2f;
 
-  // Quadratic distance for smoother wave effect
-  float expDist = dist * dist;
-  float strength = (std::sin(expDist * 50.0f) + 1.0f) / 2.0f;
-  float height = (std::sin(t * strength) + 1.0f) / 2.0f;
-  float alpha =
-      1.0f - expDist / (maxDist * maxDist) + (1.0f - height) * -0.014f;
-
-  // Color with height-based intensity
-  glm::vec3 color =
-      glm::vec3(0.9f, 0.9f, 0.9f) * height - (1.0f - alpha) * 0.652f;
-
-  // Clip outside max distance
-  if (dist > maxDist) {
-    color = glm::vec3(0.1f, 0.1f, 0.1f);
-    alpha = 0.0f;
+  // Centered coordinates with aspect ratio correction
+  float aspect = (float)DISPLAY_WIDTH / (float)DISPLAY_HEIGHT;
+  float sx = (aspect > 1.0f) ? aspect : 1.0f;
+  float sy = (aspect > 1.0f) ? 1.0f : 1.0f / aspect;
+  float y = (row.v * 2.0f - 1.0f) * sy;
+
+  // The channels are computed per pixel as plain floats and stored in their planes, so that
+  // the loop works on whole vectors of pixels
+  for (int i = 0; i < row.count; i++) {
+    float x = ((row.u + i * row.du) * 2.0f - 1.0f) * sx;
+
+    // Distance from center - reduced scaling to extend further
+    float dist = std::sqrt(x * x + y * y) * 0.35f;
+
+    // Quadratic distance for smoother wave effect
+    float expDist = dist * dist;
+    float strength = (std::sin(expDist * 50.0f) + 1.0f) / 2.0f;
+    float height = (std::sin(t * strength) + 1.0f) / 2.0f;
+    float alpha =
+        1.0f - expDist / (maxDist * maxDist) + (1.0f - height) * -0.014f;
+
+    // Gray with height-based intensity
+    float gray = 0.9f * height - (1.0f - alpha) * 0.652f;
+
+    // Clip outside max distance
+    if (dist > maxDist) {
+      gray = 0.1f;
+      alpha = 0.0f;
+    }
+
+    // Blend with black background using alpha
+    gray *= std::min(std::max(alpha, 0.0f), 1.0f);
+
+    row.r[i] = gray;
+    row.g[i] = gray;
+    row.b[i] = gray;
+    row.a[i] = 1.0f;
   }
-
-  // Blend with black background using alpha
-  color = Mix(glm::vec3(0.0f, 0.0f, 0.0f), color, Clamp(alpha, 0.0f, 1.0f));
-
-  return Color((byte)Clamp(color.r * 255.0f, 0.0f, 255.0f),
-               (byte)Clamp(color.g * 255.0f, 0.0f, 255.0f),
-               (byte)Clamp(color.b * 255.0f, 0.0f, 255.0f));
 }
 
 // ============================================================================
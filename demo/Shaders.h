@@ -1,6 +1,7 @@
 #pragma once
 
 #include <core/Color.h>
+#include <effects/PixelShaderEffect.h>
 
 /**
  * Demo shader collection
@@ -8,8 +9,9 @@
  * functionality
  */
 
-// Sine ripple shader - circular wave patterns
-Color SineShader(float u, float v, float time);
+// Sine ripple shader - circular wave patterns, shading whole rows into planes (see
+// PlanarShaderEffect)
+void SineShader(const libled::ShaderRow &row, float time);
 
 // Joy Division waves shader - iconic wave ridge patterns
 Color PleasuresShader(float u, float v, float time);
@@ -9,6 +9,7 @@
 #include <core/Graphics.h>
 #include <effects/AnimationEffect.h>
 #include <effects/CoreEffects.h>
+#include <effects/EffectRenderer.h>
 #include <effects/MotionEffects.h>
 #include <effects/OpticalEffects.h>
 #include <effects/ParticleEffects.h>
@@ -395,7 +396,7 @@ public:
                   std::clamp(roundf(epos * colorswidthf), 0.0f, colorswidthf)),
               0);
 
-          Color cc = tempCanvas.GetPixel(x, y);
+          Color cc = tempCanvas.GetPixelStraight(x, y);
           // Only apply if pixel has alpha? Or add to everything (aura)?
           // Unstoppable: ecolor.a = cc.a; ecolor.Add(cc); SetPixel.
           // This implies it only shows where there is already something? No,
@@ -409,7 +410,7 @@ public:
             // But strictly, Unstoppable SetPixel replaces it with `ecolor`
             // (which has added `cc`). So result = ecolor + original_pixel.
             ecolor.Add(cc);
-            tempCanvas.SetPixel(x, y, ecolor);
+            tempCanvas.SetPixelStraight(x, y, ecolor);
           }
         }
       }
@@ -468,7 +469,7 @@ public:
             // Check bounds for tempCanvas access too just in case
             if (x2 >= 0 && x2 < tempCanvas.Width() && y2 >= 0 &&
                 y2 < tempCanvas.Height()) {
-              Color c = tempCanvas.GetPixel(x2, y2);
+              Color c = tempCanvas.GetPixelStraight(x2, y2);
               if (c.a > 0) {
                 // Apply global opacity
                 int finalAlpha = (c.a * currentOpacity) / 255;
@@ -656,10 +657,10 @@ public:
               static_cast<int>(
                   std::clamp(roundf(epos * colorswidthf), 0.0f, colorswidthf)),
               0);
-          Color cc = tempcanvas.GetPixel(x, y);
+          Color cc = tempcanvas.GetPixelStraight(x, y);
           ecolor.a = cc.a;
           ecolor.Add(cc);
-          tempcanvas.SetPixel(x, y, ecolor);
+          tempcanvas.SetPixelStraight(x, y, ecolor);
         }
       }
     }
@@ -698,6 +699,7 @@ public:
 
 void AddBasicScenes(std::vector<Scene> &scenes, const Resources &resources) {
   scenes.push_back({"Plasma", std::make_shared<PlasmaEffect>()});
+  scenes.push_back({"Palette Plasma", std::make_shared<PalettePlasmaEffect>()});
   scenes.push_back({"Vertical Gradient", std::make_shared<GradientEffect>(
                                              Color(255, 0, 0), Color(0, 0, 255),
                                              GradientType::LinearVertical)});
@@ -798,7 +800,7 @@ void AddTextScenes(std::vector<Scene> &scenes, const Font &font, int width,
 void AddShaderScenes(std::vector<Scene> &scenes,
                      const std::shared_ptr<IEffect> &sourceForEffects) {
   scenes.push_back(
-      {"Sine Ripple", std::make_shared<PixelShaderEffect>(SineShader)});
+      {"Sine Ripple", std::make_shared<PlanarShaderEffect>(SineShader)});
   scenes.push_back({"Fire", std::make_shared<PixelShaderEffect>(FireShader)});
   scenes.push_back(
       {"Voronoi", std::make_shared<PixelShaderEffect>(VoronoiShader)});
@@ -939,6 +941,11 @@ int main(int argc, char *argv[]) {
   Audio audio(config);
   Graphics graphics(config, true);
   Canvas &canvas = graphics.GetCanvas();
+
+  // The scenes are rendered by Graphics, which renders band-safe effects on
+  // multiple threads when Graphics.RenderBands is set
+  EffectRenderer effectrenderer;
+  graphics.AddRenderer(&effectrenderer);
   Resources resources(config, graphics);
   const Font &defaultFont = resources.GetFont("boldbitslarge.fnt");
 
@@ -1043,13 +1050,11 @@ int main(int argc, char *argv[]) {
         }
       }
 
-      // Render
-      canvas.Clear(BLACK);
-      if (!scenes.empty()) {
-        scenes[currentScene].effect->Render(canvas, timeMs);
-      }
-
-      graphics.Present(false);
+      // Render. Scenes that draw over the whole frame do not need the clear.
+      if (!scenes.empty())
+        effectrenderer.SetEffect(scenes[currentScene].effect);
+      effectrenderer.SetTime(timeMs);
+      graphics.Present();
       usleep(25000);
     }
   } catch (const std::exception &ex) {
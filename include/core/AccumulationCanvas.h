@@ -0,0 +1,117 @@
+#pragma once
+#include <vector>
+#include "core/Canvas.h"
+#include "core/IRowSource.h"
+
+/*
+  An accumulation canvas collects light with 32 bits per channel, for effects that add many
+  colors on top of each other (particles, glow). Adding does not clamp at white like Color::Add
+  does, so where colors stack up they keep getting brighter instead of losing everything above
+  255. When everything is drawn, ToneMap brings the light back into the range of a Color and
+  draws it on a Canvas in a single pass.
+  The channels use the same scale as Color (255 is white). They hold more than 16 million times
+  white, far more than any effect adds, so adding is a plain integer add without a clamp. Only
+  ToneMap saturates. (16 bit channels hold only 257 times white, and the clamp they need on
+  every add took about 30% of the time of AddPixel.)
+  There is no alpha, the tone-mapped pixels are opaque. ToneMap draws them as a row source
+  (see IRowSource.h), which maps a row at a time.
+*/
+
+// How ToneMap brings light above white back into the range of a Color
+enum class ToneMapping : byte
+{
+	Clamp,	// Light above 255 becomes 255
+	Soft	// Light above a knee is compressed smoothly towards 255, so bright areas keep some detail
+};
+
+// A pixel of an accumulation canvas
+struct LightColor
+{
+	uint32_t r;
+	uint32_t g;
+	uint32_t b;
+};
+
+class AccumulationCanvas final : public IRowSource
+{
+private:
+
+	PixelBuffer<LightColor> pixels;
+	int width;
+	int height;
+
+	// The mapping of the last ToneMap, which the rows are mapped with
+	ToneMapping tonemapping;
+
+public:
+
+	// Constructor. The default constructor makes a canvas the size of the display.
+	AccumulationCanvas();
+	AccumulationCanvas(int width, int height);
+
+	// Properties
+	inline int Width() const { return width; }
+	inline int Height() const { return height; }
+	virtual Size GetSize() const override { return Size(width, height); }
+	inline const LightColor* GetBuffer() const { return pixels.data(); }
+	inline bool IsInBounds(int x, int y) const { return (x >= 0) && (y >= 0) && (x < width) && (y < height); }
+
+	// Changes the size, which clears the canvas to black
+	void Resize(int width, int height);
+
+	// Sets all pixels to the color (the alpha is ignored)
+	void Clear(Color color = BLACK);
+
+	// Adds the color by the amount of its alpha, like Color::Add without the clamp
+	inline void AddPixel(int x, int y, Color c)
+	{
+		if(!IsInBounds(x, y))
+			return;
+		LightColor& p = pixels[y * width + x];
+		uint a = static_cast<uint>(c.a);
+		p.r += DIV_255_FAST(static_cast<uint>(c.r) * a);
+		p.g += DIV_255_FAST(static_cast<uint>(c.g) * a);
+		p.b += DIV_255_FAST(static_cast<uint>(c.b) * a);
+	}
+
+	// Blends the color by the amount of its alpha, like Color::Blend. This also fades light
+	// above white, which keeps its brightness relative to white. The light is faded by the
+	// inverse alpha as a 16.16 fraction (ia / 255 rounded, exactly 1 for alpha 0), so that
+	// this takes a multiply and a shift instead of a division.
+	inline void BlendPixel(int x, int y, Color c)
+	{
+		if(!IsInBounds(x, y))
+			return;
+		LightColor& p = pixels[y * width + x];
+		uint a = static_cast<uint>(c.a);
+		uint ia = 255u - a;
+		uint64_t fade = ia * 257u + (ia >> 7);
+		p.r = DIV_255_FAST(static_cast<uint>(c.r) * a) + static_cast<uint32_t>((p.r * fade) >> 16);
+		p.g = DIV_255_FAST(static_cast<uint>(c.g) * a) + static_cast<uint32_t>((p.g * fade) >> 16);
+		p.b = DIV_255_FAST(static_cast<uint>(c.b) * a) + static_cast<uint32_t>((p.b * fade) >> 16);
+	}
+
+	inline LightColor GetPixel(int x, int y) const
+	{
+		if(IsInBounds(x, y))
+			return pixels[y * width + x];
+		return LightColor { 0u, 0u, 0u };
+	}
+
+	// Adds an image by the alpha of its pixels (straight or premultiplied), or a monochrome
+	// image with a color, where the image modulates the alpha of the color
+	void DrawColorImageAdd(Point pos, const IImage& img);
+	void DrawMonoImageAdd(Point pos, const IImage& img, Color color);
+
+	// Brings the light into the range of a Color with the mapping and draws it with the mode
+	// on the canvas, with the left-top of this canvas at pos. Use BlendMode::Add to add the
+	// light to what is already on the canvas. When the canvas is recording, the draw refers to
+	// this canvas, so it maps the light that is here when the list is executed, with the mapping
+	// of the last ToneMap before that.
+	void ToneMap(Canvas& canvas, Point pos = Point(), ToneMapping mapping = ToneMapping::Clamp, BlendMode mode = BlendMode::Opaque);
+
+	// Row source
+	virtual bool IsPremultiplied() const override { return false; }
+	virtual bool IsOpaque() const override { return true; }
+	virtual const Color* Row(int x, int y, int count, Color* scratch) const override;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include "core/IRenderer.h"
+
+/*
+  BandRenderer renders band-safe renderers (see IRenderer::IsBandSafe) on multiple threads.
+  The canvas is split into horizontal bands of about equal height and each band is rendered
+  by its own thread, through a view of the whole canvas that is clipped to that band. The
+  calling thread renders the first band itself. Render returns when all bands are finished,
+  so the canvas is complete and can be presented right after.
+*/
+class BandRenderer final
+{
+private:
+
+	// Worker threads, one for every band except the first
+	vector<std::thread> workers;
+
+	// A job is started by increasing the generation. The workers count down the pending
+	// bands when they are done with their band.
+	std::mutex mutex;
+	std::condition_variable startsignal;
+	std::condition_variable donesignal;
+	uint generation;
+	int pending;
+	bool stopthreads;
+
+	// The current job
+	int bands;
+	IRenderer* const* renderers;
+	int renderercount;
+
+	// The views of the bands and the canvas they were made for. They are kept for the next
+	// frame and only made again when the buffer, size or clip area of the canvas changed.
+	vector<std::unique_ptr<Canvas>> bandviews;
+	const Canvas* viewcanvas;
+	const Color* viewbuffer;
+	Rect viewarea;
+	Rect viewclip;
+
+	// Methods
+	void Thread(int band);
+	void RenderBand(int band);
+	void MakeViews(Canvas& canvas);
+
+public:
+
+	BandRenderer(int bands);
+	~BandRenderer();
+
+	// Properties
+	inline int Bands() const { return bands; }
+
+	// Renders the renderers, in the given order, on every band of the canvas
+	void Render(Canvas& canvas, IRenderer* const* renderers, int count);
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include "core/Image.h"
+#include "core/Rect.h"
+#include "core/GraphicsConstants.h"
+#include "core/PixelAllocator.h"
+
+/*
+  A bit mask has one bit per pixel, which says whether the pixel is in the mask. This is 32 times
+  smaller than a Canvas used as mask. The operations work on 64 pixels at once and scanning the
+  mask (see ForEachRun) skips 64 empty pixels with a single compare.
+  Rows start on a new word. Bit x % 64 of word x / 64 is pixel x, the bits right of the width in
+  the last word of a row are always zero.
+  Canvas draws through a mask with the masked drawing methods (see Canvas.h).
+*/
+class BitMask final
+{
+private:
+
+	PixelBuffer<uint64_t> words;
+	int width;
+	int height;
+	int rowwords;
+
+	// Copy of the words for Dilate and Erode, kept so that they do not allocate every time
+	PixelBuffer<uint64_t> scratch;
+
+	// Clears the bits right of the width in the last word of every row
+	void ClearPadding();
+
+	// Returns the first pixel on the row from x to limit (inclusive) of which the bit is set
+	// (or clear), or limit + 1 when there is none
+	inline int FindBit(const uint64_t* row, int x, int limit, bool set) const
+	{
+		int i = x >> 6;
+		uint64_t w = (set ? row[i] : ~row[i]) & (~0ull << (x & 63));
+		while(w == 0)
+		{
+			i++;
+			if((i << 6) > limit)
+				return limit + 1;
+			w = set ? row[i] : ~row[i];
+		}
+		return std::min((i << 6) + __builtin_ctzll(w), limit + 1);
+	}
+
+	// Grows (or shrinks) the set areas by one pixel in all directions
+	void Morph(bool grow);
+
+public:
+
+	// Constructor. The default constructor makes a mask the size of the display.
+	BitMask();
+	BitMask(int width, int height);
+
+	// Properties
+	inline int Width() const { return width; }
+	inline int Height() const { return height; }
+	inline Size GetSize() const { return Size(width, height); }
+	inline bool IsInBounds(int x, int y) const { return (x >= 0) && (y >= 0) && (x < width) && (y < height); }
+
+	// Direct access to the words. Rows are RowWords() words apart.
+	inline int RowWords() const { return rowwords; }
+	inline uint64_t* GetRow(int y) { return &words[y * rowwords]; }
+	inline const uint64_t* GetRow(int y) const { return &words[y * rowwords]; }
+
+	// Changes the size, which clears all bits
+	void Resize(int width, int height);
+
+	// Sets or clears all bits
+	void Clear(bool value = false);
+
+	// Pixels
+	inline void SetPixel(int x, int y, bool value = true)
+	{
+		if(!IsInBounds(x, y))
+			return;
+		uint64_t bit = 1ull << (x & 63);
+		uint64_t& w = words[y * rowwords + (x >> 6)];
+		w = value ? (w | bit) : (w & ~bit);
+	}
+	inline bool GetPixel(int x, int y) const
+	{
+		if(IsInBounds(x, y))
+			return ((words[y * rowwords + (x >> 6)] >> (x & 63)) & 1u) != 0;
+		return false;
+	}
+
+	// Sets or clears the bits in the rectangle
+	void SetRectangle(Rect r, bool value = true);
+
+	// Sets the bits of the pixels where the image has more coverage (monochrome) or alpha
+	// (colors) than the threshold, with the left-top of the image rectangle at pos. Other bits
+	// are left as they are.
+	void DrawImage(Point pos, const IImage& img, byte threshold = 0) { DrawImage(pos, img, Rect(Point(0, 0), img.GetSize()), threshold); }
+	void DrawImage(Point pos, const IImage& img, Rect imgrect, byte threshold = 0);
+
+	// Boolean operations with a mask of the same size, pixel by pixel
+	void And(const BitMask& other);
+	void Or(const BitMask& other);
+	void Xor(const BitMask& other);
+	void AndNot(const BitMask& other);
+	void Invert();
+
+	// Grows or shrinks the set areas by the radius in all directions (a square of 2 * radius + 1
+	// pixels). Pixels outside the mask count as clear, so Erode also shrinks areas at the edges.
+	void Dilate(int radius = 1);
+	void Erode(int radius = 1);
+
+	// Counting
+	int Count() const;
+	bool IsEmpty() const;
+
+	// Returns the smallest rectangle with all set bits, which is empty when no bits are set
+	Rect GetBounds() const;
+
+	// Calls f(y, x1, x2) for every run of set bits from x1 to x2 (inclusive) on row y, limited
+	// to the area from left-top to right-bottom (inclusive, which must be inside the mask).
+	// Rows are scanned a word at a time, skipping the words without set bits.
+	template<typename F> void ForEachRun(int left, int top, int right, int bottom, F f) const
+	{
+		for(int y = top; y <= bottom; y++)
+		{
+			const uint64_t* row = GetRow(y);
+			int x = FindBit(row, left, right, true);
+			while(x <= right)
+			{
+				int end = FindBit(row, x, right, false);
+				f(y, x, end - 1);
+				x = (end <= right) ? FindBit(row, end, right, true) : end;
+			}
+		}
+	}
+	template<typename F> void ForEachRun(F f) const
+	{
+		if((width > 0) && (height > 0))
+			ForEachRun(0, 0, width - 1, height - 1, f);
+	}
+
+	// Calls f(x, y) for every set bit
+	template<typename F> void ForEachPixel(F f) const
+	{
+		ForEachRun([&](int y, int x1, int x2)
+		{
+			for(int x = x1; x <= x2; x++)
+				f(x, y);
+		});
+	}
+};
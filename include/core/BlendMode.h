@@ -0,0 +1,21 @@
+#pragma once
+#include "utils/Tools.h"
+
+// How drawn colors combine with the pixels on the canvas. The drawing methods that take
+// a mode work like the methods with the matching name suffix (DrawColorImageBlend and so on).
+// The modes from Multiply on have no such methods, they blend by the alpha of the drawn
+// colors like Blend does.
+enum class BlendMode : byte
+{
+	Opaque,		// Replaces the pixels
+	Blend,		// Blends by the alpha of the drawn colors (see Color::Blend)
+	Add,		// Adds by the alpha of the drawn colors (see Color::Add)
+	Mask,		// Replaces the pixels where the drawn colors have alpha (see Color::Mask)
+	Multiply,	// Darkens by multiplying the colors (see Color::Multiply)
+	Screen,		// Lightens by multiplying the inverted colors (see Color::Screen)
+	Overlay,	// Multiplies dark pixels and screens light pixels (see Color::Overlay)
+	Darken,		// Takes the lowest value of each channel (see Color::Darken)
+	Lighten,	// Takes the highest value of each channel (see Color::Lighten)
+	Difference	// Takes the difference of each channel (see Color::Difference)
+};
+
@@ -0,0 +1,337 @@
+#pragma once
+#include <cstring>
+#include "core/BlendMode.h"
+#include "core/ColorSpan.h"
+#include "core/IImage.h"
+#include "core/IRowSource.h"
+#include "core/Point.h"
+#include "core/Rect.h"
+
+/*
+  These are the building blocks for Canvas::Blit, which draws a clipped image rectangle row by row.
+  A blit draws one or more image rectangles with a combination of a source, a modulation and an
+  operation:
+  - The source produces a row of colors from the image. Sources that can point directly into the
+    image data do so, others generate the colors into a scratch buffer. Prepare() is called with
+    each image rectangle before its rows are produced.
+  - The modulation optionally modulates that row of colors.
+  - The operation writes the row of colors onto the canvas.
+  None of these check bounds, because the blitter has already clipped the rectangle.
+*/
+
+// Number of pixels the blitter processes at once
+static constexpr int BLIT_CHUNK_SIZE = 256;
+
+// Largest image width and height for transformed drawing, so that the 16.16 fixed-point
+// image coordinates and the steps between pixels fit in an int
+static constexpr int BLIT_MAX_TRANSFORMED_SIZE = 16384;
+
+// An image rectangle to draw at a position on the canvas
+struct BlitItem
+{
+	Point pos;
+	Rect imgrect;
+
+	BlitItem() {}
+	BlitItem(Point p, Rect r) : pos(p), imgrect(r) {}
+};
+
+// Source for color images
+struct ColorSource
+{
+	ColorSampler sampler;
+
+	ColorSource(const IImage& img) : sampler(img.GetColorSampler()) {}
+	inline void Prepare(const Rect&) {}
+	inline const Color* Row(int x, int y, int, Color*) const { return sampler.Pointer(x, y); }
+};
+
+// Source for row sources, which produce the colors themselves (see IRowSource.h)
+struct RowSource
+{
+	const IRowSource& rows;
+
+	RowSource(const IRowSource& r) : rows(r) {}
+	inline void Prepare(const Rect&) {}
+	inline const Color* Row(int x, int y, int count, Color* scratch) const { return rows.Row(x, y, count, scratch); }
+};
+
+// How the coverage of a monochrome image applies to the color it is drawn with
+struct CoverageModulatesColor { static inline Color Apply(Color c, byte coverage) { c.ModulateRGBA(coverage); return c; } };
+struct CoverageModulatesAlpha { static inline Color Apply(Color c, byte coverage) { c.ModulateA(coverage); return c; } };
+struct CoverageIsAlpha { static inline Color Apply(Color c, byte coverage) { c.a = coverage; return c; } };
+
+// Source for monochrome images drawn with a single color
+template<typename Coverage>
+struct MonoSource
+{
+	MonoSampler sampler;
+	Color color;
+
+	MonoSource(const IImage& img, Color c) : sampler(img.GetMonoSampler()), color(c) {}
+	inline void Prepare(const Rect&) {}
+	inline const Color* Row(int x, int y, int count, Color* scratch) const
+	{
+		const byte* coverage = sampler.Pointer(x, y);
+		for(int i = 0; i < count; i++)
+			scratch[i] = Coverage::Apply(color, coverage[i]);
+		return scratch;
+	}
+};
+
+// Source for monochrome images drawn with a repeating color texture. The coverage applies to the
+// texture colors as it would to a single color: CoverageModulatesAlpha for straight alpha textures
+// and CoverageModulatesColor for premultiplied textures.
+// The texture coordinates are wrapped once per row. From there the row walks through the texture
+// in runs up to the texture edge, or with a mask when the texture width is a power of two, so that
+// there is no division per pixel.
+template<typename Coverage>
+struct MonoTexturedSource
+{
+	MonoSampler sampler;
+	ColorSampler texsampler;
+	int texwidth;
+	int texheight;
+
+	// Masks for wrapping the texture coordinates, or -1 when the size is not a power of two
+	int texwidthmask;
+	int texheightmask;
+
+	// Texture coordinates of the left-top of the image rectangle, and of the image origin
+	Point texoffset;
+	Point texorigin;
+
+	MonoTexturedSource(const IImage& img, const IImage& tex, Point offset) :
+		sampler(img.GetMonoSampler()),
+		texsampler(tex.GetColorSampler()),
+		texwidth(tex.Width()),
+		texheight(tex.Height()),
+		texwidthmask(IsPowerOfTwo(tex.Width()) ? tex.Width() - 1 : -1),
+		texheightmask(IsPowerOfTwo(tex.Height()) ? tex.Height() - 1 : -1),
+		texoffset(offset)
+	{
+	}
+
+	static inline bool IsPowerOfTwo(int v) { return (v > 0) && ((v & (v - 1)) == 0); }
+
+	// Wraps a texture coordinate into [0, size), also when it is negative
+	static inline int Wrap(int v, int size, int mask)
+	{
+		if(mask >= 0)
+			return v & mask;
+		int w = v % size;
+		return (w < 0) ? w + size : w;
+	}
+
+	inline void Prepare(const Rect& imgrect)
+	{
+		texorigin = Point(texoffset.x - imgrect.x, texoffset.y - imgrect.y);
+	}
+
+	inline const Color* Row(int x, int y, int count, Color* scratch) const
+	{
+		const byte* coverage = sampler.Pointer(x, y);
+		const Color* texrow = texsampler.Pointer(0, Wrap(texorigin.y + y, texheight, texheightmask));
+		int tx = Wrap(texorigin.x + x, texwidth, texwidthmask);
+		if(texwidthmask >= 0)
+		{
+			for(int i = 0; i < count; i++)
+				scratch[i] = Coverage::Apply(texrow[(tx + i) & texwidthmask], coverage[i]);
+		}
+		else
+		{
+			for(int i = 0; i < count; )
+			{
+				int run = std::min(count - i, texwidth - tx);
+				for(int end = i + run; i < end; i++, tx++)
+					scratch[i] = Coverage::Apply(texrow[tx], coverage[i]);
+				tx = 0;
+			}
+		}
+		return scratch;
+	}
+};
+
+// Transformed sources produce a row of colors for Canvas::BlitTransformed by stepping through
+// the image with 16.16 fixed-point coordinates (u, v) from pixel to pixel. The blitter has
+// limited the row to the pixels whose coordinates lie inside the image.
+
+// Sampling filters for the transformed sources
+struct NearestFilter
+{
+	template<typename Sampler>
+	static inline auto Sample(const Sampler& sampler, int u, int v, int, int) { return sampler(u >> 16, v >> 16); }
+};
+
+struct BilinearFilter
+{
+	// Pixel centers are at +0.5, so the filter interpolates from half a pixel before the coordinates.
+	// Near the edges the pixels outside the image are replaced by the pixels on the edge.
+	static inline void Prepare(int& u, int& v, int maxx, int maxy, int& x0, int& y0, int& x1, int& y1, uint& fx, uint& fy)
+	{
+		u = std::max(u - 0x8000, 0);
+		v = std::max(v - 0x8000, 0);
+		x0 = u >> 16;
+		y0 = v >> 16;
+		x1 = x0 + (x0 < maxx ? 1 : 0);
+		y1 = y0 + (y0 < maxy ? 1 : 0);
+		fx = static_cast<uint>(u >> 8) & 0xFFu;
+		fy = static_cast<uint>(v >> 8) & 0xFFu;
+	}
+
+	static inline uint Lerp(uint p00, uint p10, uint p01, uint p11, uint fx, uint fy)
+	{
+		uint top = p00 * (256u - fx) + p10 * fx;
+		uint bottom = p01 * (256u - fx) + p11 * fx;
+		return (top * (256u - fy) + bottom * fy) >> 16;
+	}
+
+	static inline byte Sample(const MonoSampler& sampler, int u, int v, int maxx, int maxy)
+	{
+		int x0, y0, x1, y1;
+		uint fx, fy;
+		Prepare(u, v, maxx, maxy, x0, y0, x1, y1, fx, fy);
+		return static_cast<byte>(Lerp(sampler(x0, y0), sampler(x1, y0), sampler(x0, y1), sampler(x1, y1), fx, fy));
+	}
+
+	static inline Color Sample(const ColorSampler& sampler, int u, int v, int maxx, int maxy)
+	{
+		int x0, y0, x1, y1;
+		uint fx, fy;
+		Prepare(u, v, maxx, maxy, x0, y0, x1, y1, fx, fy);
+		Color p00 = sampler(x0, y0);
+		Color p10 = sampler(x1, y0);
+		Color p01 = sampler(x0, y1);
+		Color p11 = sampler(x1, y1);
+		return Color(
+			static_cast<byte>(Lerp(p00.r, p10.r, p01.r, p11.r, fx, fy)),
+			static_cast<byte>(Lerp(p00.g, p10.g, p01.g, p11.g, fx, fy)),
+			static_cast<byte>(Lerp(p00.b, p10.b, p01.b, p11.b, fx, fy)),
+			static_cast<byte>(Lerp(p00.a, p10.a, p01.a, p11.a, fx, fy)));
+	}
+};
+
+// Transformed source for color images
+template<typename Filter>
+struct TransformedColorSource
+{
+	ColorSampler sampler;
+	int maxx;
+	int maxy;
+
+	TransformedColorSource(const IImage& img) : sampler(img.GetColorSampler()), maxx(img.Width() - 1), maxy(img.Height() - 1) {}
+	inline const Color* Row(int u, int v, int du, int dv, int count, Color* scratch) const
+	{
+		for(int i = 0; i < count; i++, u += du, v += dv)
+			scratch[i] = Filter::Sample(sampler, u, v, maxx, maxy);
+		return scratch;
+	}
+};
+
+// Transformed source for monochrome images drawn with a single color
+template<typename Filter, typename Coverage>
+struct TransformedMonoSource
+{
+	MonoSampler sampler;
+	Color color;
+	int maxx;
+	int maxy;
+
+	TransformedMonoSource(const IImage& img, Color c) : sampler(img.GetMonoSampler()), color(c), maxx(img.Width() - 1), maxy(img.Height() - 1) {}
+	inline const Color* Row(int u, int v, int du, int dv, int count, Color* scratch) const
+	{
+		for(int i = 0; i < count; i++, u += du, v += dv)
+			scratch[i] = Coverage::Apply(color, Filter::Sample(sampler, u, v, maxx, maxy));
+		return scratch;
+	}
+};
+
+// Modulations
+struct NoModulation
+{
+	inline const Color* Apply(const Color* row, int, Color*) const { return row; }
+};
+
+struct ColorModulation
+{
+	Color mod;
+
+	ColorModulation(Color m) : mod(m) {}
+	inline const Color* Apply(const Color* row, int count, Color* scratch) const
+	{
+		ModulateSpan(scratch, row, mod, count);
+		return scratch;
+	}
+};
+
+// Converts the colors between straight and premultiplied alpha
+struct PremultiplyModulation
+{
+	inline const Color* Apply(const Color* row, int count, Color* scratch) const
+	{
+		PremultiplySpan(scratch, row, count);
+		return scratch;
+	}
+};
+
+struct UnpremultiplyModulation
+{
+	inline const Color* Apply(const Color* row, int count, Color* scratch) const
+	{
+		UnpremultiplySpan(scratch, row, count);
+		return scratch;
+	}
+};
+
+// Applies two modulations one after the other
+template<typename First, typename Second>
+struct ChainedModulation
+{
+	First first;
+	Second second;
+
+	ChainedModulation(const First& f, const Second& s) : first(f), second(s) {}
+	inline const Color* Apply(const Color* row, int count, Color* scratch) const
+	{
+		return second.Apply(first.Apply(row, count, scratch), count, scratch);
+	}
+};
+
+// Operations
+struct OpaqueOp { static inline void Apply(Color* dst, const Color* src, int count) { memmove(dst, src, count * sizeof(Color)); } };
+struct BlendOp { static inline void Apply(Color* dst, const Color* src, int count) { BlendSpan(dst, src, count); } };
+struct AddOp { static inline void Apply(Color* dst, const Color* src, int count) { AddSpan(dst, src, count); } };
+struct BlendPremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { BlendPremultipliedSpan(dst, src, count); } };
+struct AddPremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { AddPremultipliedSpan(dst, src, count); } };
+struct MaskOp { static inline void Apply(Color* dst, const Color* src, int count) { MaskSpan(dst, src, count); } };
+struct MultiplyOp { static inline void Apply(Color* dst, const Color* src, int count) { MultiplySpan(dst, src, count); } };
+struct MultiplyPremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { MultiplyPremultipliedSpan(dst, src, count); } };
+struct ScreenOp { static inline void Apply(Color* dst, const Color* src, int count) { ScreenSpan(dst, src, count); } };
+struct ScreenPremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { ScreenPremultipliedSpan(dst, src, count); } };
+struct OverlayOp { static inline void Apply(Color* dst, const Color* src, int count) { OverlaySpan(dst, src, count); } };
+struct OverlayPremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { OverlayPremultipliedSpan(dst, src, count); } };
+struct DarkenOp { static inline void Apply(Color* dst, const Color* src, int count) { DarkenSpan(dst, src, count); } };
+struct DarkenPremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { DarkenPremultipliedSpan(dst, src, count); } };
+struct LightenOp { static inline void Apply(Color* dst, const Color* src, int count) { LightenSpan(dst, src, count); } };
+struct LightenPremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { LightenPremultipliedSpan(dst, src, count); } };
+struct DifferenceOp { static inline void Apply(Color* dst, const Color* src, int count) { DifferenceSpan(dst, src, count); } };
+struct DifferencePremultipliedOp { static inline void Apply(Color* dst, const Color* src, int count) { DifferencePremultipliedSpan(dst, src, count); } };
+
+// Calls f with the operations of the blend mode for straight and premultiplied pixels
+template<typename F>
+inline void WithBlendModeOps(BlendMode mode, F f)
+{
+	switch(mode)
+	{
+		case BlendMode::Opaque: f(OpaqueOp(), OpaqueOp()); break;
+		case BlendMode::Blend: f(BlendOp(), BlendPremultipliedOp()); break;
+		case BlendMode::Add: f(AddOp(), AddPremultipliedOp()); break;
+		case BlendMode::Mask: f(MaskOp(), MaskOp()); break;
+		case BlendMode::Multiply: f(MultiplyOp(), MultiplyPremultipliedOp()); break;
+		case BlendMode::Screen: f(ScreenOp(), ScreenPremultipliedOp()); break;
+		case BlendMode::Overlay: f(OverlayOp(), OverlayPremultipliedOp()); break;
+		case BlendMode::Darken: f(DarkenOp(), DarkenPremultipliedOp()); break;
+		case BlendMode::Lighten: f(LightenOp(), LightenPremultipliedOp()); break;
+		case BlendMode::Difference: f(DifferenceOp(), DifferencePremultipliedOp()); break;
+	}
+}
@@ -1,86 +1,444 @@
 #pragma once
 #include "core/GraphicsConstants.h"
+#include "core/ColorSpan.h"
 #include "core/Image.h"
 #include "core/Rect.h"
+#include "core/Damage.h"
+#include "core/DrawList.h"
+#include "core/BitMask.h"
+#include "core/PixelAllocator.h"
 
-class Canvas final : public virtual IImage {
+// What Scroll does with the pixels that scroll out of the area
+enum class ScrollMode : byte {
+  Wrap, // They scroll back in on the other side
+  Fill  // They are lost, the pixels that scroll in get the fill color
+};
+
+class Canvas : public virtual IImage {
 private:
-  // The buffer to which we draw
-  std::vector<Color> renderbuffer;
+  // The buffer to which we draw. This is empty for a view (see CanvasView.h),
+  // which draws in the buffer of the canvas it views.
+  PixelBuffer<Color> renderbuffer;
+
+  // Pixel (0, 0) of this canvas in the buffer
+  Color *pixels;
+
+  // Dimensions of this canvas. The stride is the number of pixels from the
+  // start of one row to the start of the next row in the buffer.
+  int width;
+  int height;
+  int stride;
+
+  // The area that has pixels in the buffer (inclusive coordinates). This is
+  // the whole canvas, unless this is a view that lies partially outside its
+  // parent.
+  int boundsleft;
+  int boundstop;
+  int boundsright;
+  int boundsbottom;
+
+  // The area we are allowed to draw in (inclusive coordinates). These are the
+  // bounds, limited by the clip rectangles pushed with PushClip().
+  int clipleft;
+  int cliptop;
+  int clipright;
+  int clipbottom;
+
+  // The clip areas which PopClip() restores
+  std::vector<Rect> clipstack;
+
+  // The canvas that owns the buffer and our position on it. For a canvas
+  // that is not a view, this is the canvas itself at (0, 0).
+  Canvas *owner;
+  Point ownerpos;
+
+  // Damage tracking (see Damage.h). The damage holds what was drawn since the
+  // last ResetDamage(). The drawn region holds what was drawn since the last
+  // Clear(), everything outside of it still has the clear color. This lets
+  // Clear() skip the pixels that already have the clear color. Views add
+  // their damage to the owner.
+  bool trackdamage;
+  bool cleared;
+  Color clearcolor;
+  Damage damage;
+  Damage drawn;
+
+  // When set, the pixels are stored with premultiplied alpha (see
+  // SetPremultiplied). Views use the setting of the owner.
+  bool premultiplied;
+
+  // The draw list the drawing methods record to instead of drawing (see
+  // BeginRecording). Views use the list of the owner.
+  DrawList *recording;
+
+  // A row of pixels for Scroll to put aside, kept so that scrolling every
+  // frame does not allocate every frame
+  PixelBuffer<Color> scrollbuffer;
+
+  // Converts a color given to a drawing method to the way pixels are stored
+  inline Color CanvasColor(Color c) const {
+    if (owner->premultiplied)
+      c.Premultiply();
+    return c;
+  }
+
+  // The canvas that collects our damage. This is the owner, except for views
+  // which collect their own damage, so that they can draw on another thread
+  // than the owner (see BandRenderer.h). Their damage is merged afterwards.
+  Canvas *damageowner;
+
+  // Adds the given (clipped) area to the damage
+  inline void AddDamage(int x1, int y1, int x2, int y2) {
+    if (owner->trackdamage) {
+      damageowner->damage.AddRect(x1 + ownerpos.x, y1 + ownerpos.y,
+                                  x2 + ownerpos.x, y2 + ownerpos.y);
+      damageowner->drawn.AddRect(x1 + ownerpos.x, y1 + ownerpos.y,
+                                 x2 + ownerpos.x, y2 + ownerpos.y);
+    }
+  }
+  inline void AddDamage(int x, int y) {
+    if (owner->trackdamage) {
+      damageowner->damage.AddPixel(x + ownerpos.x, y + ownerpos.y);
+      damageowner->drawn.AddPixel(x + ownerpos.x, y + ownerpos.y);
+    }
+  }
+
+  // Adds the damage collected by a view with its own damage and clears that
+  void MergeDamage(Canvas &view);
+
+  // Clipping helpers
+  inline bool IsClipEmpty() const {
+    return (clipleft > clipright) || (cliptop > clipbottom);
+  }
+  inline bool IsClipFull() const {
+    return (clipleft == 0) && (cliptop == 0) && (clipright == width - 1) &&
+           (clipbottom == height - 1);
+  }
+  inline bool IsInBounds(int x, int y) const {
+    return (x >= boundsleft) && (x <= boundsright) && (y >= boundstop) &&
+           (y <= boundsbottom);
+  }
+  inline bool IsInClip(int x, int y) const {
+    return (x >= clipleft) && (x <= clipright) && (y >= cliptop) &&
+           (y <= clipbottom);
+  }
+
+  // Returns true when the rectangle between the two points (inclusive) is at
+  // least partially inside the clip rectangle
+  inline bool IsInClip(Point lefttop, Point rightbottom) const {
+    return !IsClipEmpty() && (lefttop.x <= clipright) &&
+           (lefttop.y <= clipbottom) && (rightbottom.x >= clipleft) &&
+           (rightbottom.y >= cliptop);
+  }
+
+  // Moves the point inside the clip rectangle (which must not be empty)
+  inline Point ClipPoint(Point p) const {
+    return Point(std::clamp(p.x, clipleft, clipright),
+                 std::clamp(p.y, cliptop, clipbottom));
+  }
+
+  // Returns the span kernel which draws a single color with the mode, for the
+  // way the pixels are stored (see ColorSpan.h)
+  ColorSpanFunction GetColorSpan(BlendMode mode) const;
+
+  // Draws a span of a filled shape on row y, from x1 to x2 (inclusive). This
+  // clips the span, the fillers produce spans without checking bounds.
+  inline void FillRow(int y, int x1, int x2, Color color,
+                      ColorSpanFunction span) {
+    if ((y < cliptop) || (y > clipbottom))
+      return;
+    x1 = std::max(x1, clipleft);
+    x2 = std::min(x2, clipright);
+    if (x1 > x2)
+      return;
+    span(&pixels[y * stride + x1], color, x2 - x1 + 1);
+    AddDamage(x1, y, x2, y);
+  }
 
   // Helper method to prepare for image drawing. This clips input coordinates,
   // modifies the image rect and determines the drawing rect. Returns false when
   // the image is completely outside the display, otherwise returns true.
-  bool PrepareImageDraw(Point pos, const IImage &img, Rect &imgrect,
+  bool PrepareImageDraw(Point pos, Size imgsize, Rect &imgrect,
                         Rect &drawrect);
 
+  // Draws the image rectangles at their positions, combining the rows from
+  // the source (see Blitter.h) onto the buffer with the operation. The image
+  // size is that of the image or row source. This clips once per rectangle,
+  // the inner loops do not check bounds.
+  template <typename Op, typename Source, typename Modulation>
+  void Blit(Size imgsize, const BlitItem *items, int count, Source source,
+            const Modulation &modulation);
+
+  // Blits a source which produces straight or premultiplied colors, converting
+  // them when the canvas stores the other kind. The operation is chosen by the
+  // kind the canvas stores and the modulation must match that too.
+  template <typename StraightOp, typename PremultipliedOp, typename Source,
+            typename Modulation>
+  void BlitColors(Size imgsize, const BlitItem *items, int count,
+                  Source source, bool sourcepremultiplied,
+                  const Modulation &modulation);
+
+  // Blits a monochrome image with a texture, like BlitColors
+  template <typename StraightOp, typename PremultipliedOp, typename Modulation>
+  void BlitTextured(const IImage &img, const IImage &tex, Point texoffset,
+                    const BlitItem *items, int count,
+                    const Modulation &modulation);
+
+  // Determines the area a transformed image may draw in (inclusive
+  // coordinates), limited to the clip rectangle. The transform places the
+  // image relative to the origin. Returns false when the image is completely
+  // outside the clip rectangle or the transform has no inverse.
+  bool PrepareTransformedDraw(const IImage &img, const Transform &transform,
+                              Point origin, int &left, int &top, int &right,
+                              int &bottom) const;
+
+  // Draws the image with the transform, combining rows from a transformed
+  // source (see Blitter.h) onto the buffer with the operation. Every row is
+  // clipped to the pixels that sample inside the image, the inner loops do not
+  // check bounds.
+  template <typename Op, typename Source, typename Modulation>
+  void BlitTransformed(const IImage &img, const Transform &transform,
+                       Point origin, Source source,
+                       const Modulation &modulation);
+
+  // Blits a transformed source with conversion, like BlitColors
+  template <typename StraightOp, typename PremultipliedOp, typename Source,
+            typename Modulation>
+  void BlitTransformedColors(const IImage &img, const Transform &transform,
+                             Point origin, Source source,
+                             bool sourcepremultiplied,
+                             const Modulation &modulation);
+
+  // Draws the transformed image of the command with the sampling filter
+  template <typename Filter> void DrawFiltered(const DrawCommand &command);
+
+  // Records transformed drawing while recording, otherwise draws it right away
+  void DrawTransformed(DrawCommand command);
+
+  // Adds the command to the draw list we are recording to, in the
+  // coordinates of the owner
+  void Record(DrawCommand command) const;
+
+  // Records image drawing while recording, otherwise draws it right away
+  void DrawImage(DrawOp op, Point pos, const IImage &img, Rect imgrect,
+                 Color color = Color(), const IImage *tex = nullptr,
+                 Point texoffset = Point(),
+                 BlendMode mode = BlendMode::Opaque);
+
+  // Draws image rectangles which share the state of the command. This is
+  // where draw lists draw their batches. Transformed drawing has no
+  // rectangles, it draws the image of the command once.
+  void DrawItems(const DrawCommand &state, const BlitItem *items, int count);
+
+  // Draws the image of the command at pos through the mask at maskpos. Every
+  // run of set bits becomes an image rectangle of one row, which are drawn in
+  // batches with DrawItems.
+  void DrawItemsMasked(const DrawCommand &state, Point pos, const BitMask &mask,
+                       Point maskpos);
+  friend class DrawList;
+  friend class BandRenderer;
+  friend class Convolution;
+
+protected:
+  // Constructor for views on the given area of the parent canvas. With
+  // owndamage the view collects its own damage (see damageowner).
+  Canvas(Canvas &parent, Rect area, bool owndamage = false);
+
 public:
   // Constructor/destructor
+  // The default constructor makes a canvas the size of the display.
+  // A copy always has its own buffer, also when copying a view.
   Canvas();
-  ~Canvas();
+  Canvas(int w, int h);
+  Canvas(const Canvas &other);
+  virtual ~Canvas();
+  Canvas &operator=(const Canvas &other);
+
+  // Resize buffer (not possible on views)
+  void Resize(int w, int h);
 
-  // Resize buffer
-  void Resize(int width, int height);
+  // Returns true when this canvas draws in the buffer of another canvas
+  inline bool IsView() const { return owner != this; }
 
-  // Direct buffer access
-  inline const Color *GetBuffer() const { return renderbuffer.data(); }
+  // Damage tracking. When this is enabled, all drawing methods add the area
+  // they draw to the damage, so that the display only needs to update that.
+  // When this is disabled, the whole canvas is always reported as damaged.
+  // On a view, these apply to the canvas that owns the buffer.
+  void TrackDamage(bool enable);
+  inline bool IsTrackingDamage() const { return owner->trackdamage; }
+  inline const Damage &GetDamage() const { return owner->damage; }
+  inline void ResetDamage() {
+    if (owner->trackdamage)
+      owner->damage.Clear();
+  }
+
+  // Premultiplied alpha. When enabled, the pixels are stored with premultiplied
+  // alpha, so that blending takes one multiply per channel and layers composite
+  // their alpha correctly. The existing pixels are converted. Colors given to
+  // drawing methods remain straight alpha, images are converted while drawing
+  // unless they are premultiplied already (see Image::Premultiply). Only
+  // SetPixel and GetPixel use the pixels as they are stored (see
+  // SetPixelStraight and GetPixelStraight). On a view, this applies to the
+  // canvas that owns the buffer.
+  void SetPremultiplied(bool enable);
+
+  // Recording. While recording, the Clear, DrawLine, DrawRectangle, image
+  // drawing and DrawRows methods add their calls to the draw list instead of
+  // drawing, so that the list can draw them later (see DrawList.h). The pixel
+  // methods (SetPixel, BlendPixel and so on), CopyRegion, Scroll, masked
+  // drawing and filters (see Convolution.h) are not recorded, they draw right
+  // away.
+  // On a view, this applies to the canvas that owns the buffer.
+  inline void BeginRecording(DrawList &list) { owner->recording = &list; }
+  inline void EndRecording() { owner->recording = nullptr; }
+  inline bool IsRecording() const { return owner->recording != nullptr; }
+
+  // Clipping. All drawing is limited to the intersection of the rectangles
+  // pushed on the clip stack. PopClip() restores the clip area as it was
+  // before the matching PushClip(). A view starts with the clip area of its
+  // parent at the time the view was made.
+  void PushClip(Rect r);
+  void PopClip();
+  Rect GetClip() const;
+
+  // Direct buffer access. Rows are Stride() pixels apart in the buffer.
+  inline const Color *GetBuffer() const { return pixels; }
+  inline int Stride() const { return stride; }
 
   // IImage implementation
   virtual bool HasColors() const override final { return true; }
-  virtual int Width() const override final { return DISPLAY_WIDTH; }
-  virtual int Height() const override final { return DISPLAY_HEIGHT; }
-  virtual Size GetSize() const override final {
-    return Size(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  virtual bool IsPremultiplied() const override final {
+    return owner->premultiplied;
   }
+  virtual int Width() const override final { return width; }
+  virtual int Height() const override final { return height; }
+  virtual Size GetSize() const override final { return Size(width, height); }
   virtual const byte *ByteData() const override final {
-    return reinterpret_cast<const byte *>(renderbuffer.data());
-  }
-  virtual const Color *ColorData() const override final {
-    return renderbuffer.data();
+    return reinterpret_cast<const byte *>(pixels);
   }
+  virtual const Color *ColorData() const override final { return pixels; }
   virtual MonoSampler GetMonoSampler() const override final {
     NOT_SUPPORTED;
     return MonoSampler(nullptr, 0);
   }
   virtual ColorSampler GetColorSampler() const override final {
-    return ColorSampler(renderbuffer.data(), DISPLAY_WIDTH);
+    return ColorSampler(pixels, stride);
   }
 
   // Rasterizing methods
   void Clear(Color color);
-  void CopyTo(Canvas &canvas) const {
-    if (canvas.renderbuffer.size() != renderbuffer.size())
-      canvas.renderbuffer.resize(renderbuffer.size());
-    memcpy(canvas.renderbuffer.data(), renderbuffer.data(),
-           renderbuffer.size() * sizeof(Color));
-  }
+  void CopyTo(Canvas &canvas) const;
+
+  // Copies an area of the source canvas to destPoint, row by row. The source
+  // may share the buffer with this canvas, also when the areas overlap.
   void CopyRegion(const Canvas &source, Rect sourceRect, Point destPoint);
+
+  // Moves the pixels in the clip rectangle by dx to the right and dy down.
+  // This moves rows in memory, which is much cheaper than drawing them again.
+  void Scroll(int dx, int dy, ScrollMode mode = ScrollMode::Wrap,
+              Color fillcolor = Color(0, 0, 0, 0));
   void WriteToFile(String filename) const;
+
+  // Copies the pixels to dst, which has room for Width() * Height() colors,
+  // with the rows packed together and straight alpha, like image encoders
+  // expect. Pixels outside the bounds of a view are transparent black.
+  void ReadPixels(Color *dst) const;
+
+  // Frame hashing. HashRow returns a hash of the pixels on row y (see
+  // HashSpan), HashRows the hashes of all rows. A row that changed almost
+  // certainly has another hash, so this tells which rows changed since a
+  // previous frame without keeping a copy of it.
+  uint32_t HashRow(int y) const;
+  void HashRows(std::vector<uint32_t> &hashes) const;
+
+  // Compares the hashes of the rows with the hashes of a previous frame (from
+  // HashRows or a previous DiffRows) and updates those to this frame. The
+  // rows that changed become the damage in changed, as whole rows. When the
+  // hashes are not of a frame of this height, all rows have changed. Returns
+  // true when any row changed.
+  bool DiffRows(std::vector<uint32_t> &hashes, Damage &changed) const;
   inline void SetPixel(int x, int y, Color c) {
-    if (x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
-      renderbuffer[y * DISPLAY_WIDTH + x] = c;
+    if (IsInClip(x, y)) {
+      pixels[y * stride + x] = c;
+      AddDamage(x, y);
+    }
   }
   inline Color GetPixel(int x, int y) const {
-    if (x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
-      return renderbuffer[y * DISPLAY_WIDTH + x];
+    if (IsInBounds(x, y))
+      return pixels[y * stride + x];
     return Color(0, 0, 0, 0);
   }
+  // Like SetPixel and GetPixel, but with straight alpha colors, which are
+  // converted when the canvas is premultiplied. Use these when a pixel is
+  // read to be blended or drawn again, or when a computed color is stored.
+  inline void SetPixelStraight(int x, int y, Color c) {
+    SetPixel(x, y, CanvasColor(c));
+  }
+  inline Color GetPixelStraight(int x, int y) const {
+    Color c = GetPixel(x, y);
+    if (owner->premultiplied)
+      c.Unpremultiply();
+    return c;
+  }
   inline void BlendPixel(int x, int y, Color c) {
-    if (x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
-      renderbuffer[y * DISPLAY_WIDTH + x].Blend(c);
+    if (IsInClip(x, y)) {
+      if (owner->premultiplied)
+        pixels[y * stride + x].BlendPremultiplied(CanvasColor(c));
+      else
+        pixels[y * stride + x].Blend(c);
+      AddDamage(x, y);
+    }
   }
   inline void AddPixel(int x, int y, Color c) {
-    if (x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
-      renderbuffer[y * DISPLAY_WIDTH + x].Add(c);
+    if (IsInClip(x, y)) {
+      if (owner->premultiplied)
+        pixels[y * stride + x].AddPremultiplied(CanvasColor(c));
+      else
+        pixels[y * stride + x].Add(c);
+      AddDamage(x, y);
+    }
   }
   inline void MaskPixel(int x, int y, Color c) {
-    if (x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
-      renderbuffer[y * DISPLAY_WIDTH + x].Mask(c);
+    if (IsInClip(x, y)) {
+      pixels[y * stride + x].Mask(c);
+      AddDamage(x, y);
+    }
   }
   void DrawLine(Point p1, Point p2, Color color);
   void DrawLineBlend(Point p1, Point p2, Color color);
-  void DrawRectangle(Point p1, Point p2, Color linecolor, Color fillcolor);
-  void DrawRectangleBlend(Point p1, Point p2, Color linecolor, Color fillcolor);
+  void DrawRectangle(Point p1, Point p2, Color linecolor, Color fillcolor) {
+    DrawRectangle(p1, p2, linecolor, fillcolor, BlendMode::Opaque);
+  }
+  void DrawRectangleBlend(Point p1, Point p2, Color linecolor,
+                          Color fillcolor) {
+    DrawRectangle(p1, p2, linecolor, fillcolor, BlendMode::Blend);
+  }
+  void DrawRectangle(Point p1, Point p2, Color linecolor, Color fillcolor,
+                     BlendMode mode);
+
+  // Filled shapes. These produce horizontal spans row by row and draw them
+  // with the span kernels, so that filling costs about the same as drawing a
+  // rectangle of the same area. Polygons may be concave and use the even-odd
+  // rule. Their vertices are pixel centers and they fill the pixels with
+  // their center inside, counting the left and top edges as inside but not
+  // the right and bottom edges, so that polygons sharing an edge (like the
+  // slices of a pie chart) never draw a pixel twice. Ellipses, circles and
+  // rounded rectangles include the pixels on their extremes, like
+  // DrawRectangle.
+  void FillPolygon(const Point *points, int count, Color color,
+                   BlendMode mode = BlendMode::Opaque);
+  void FillPolygon(const std::vector<Point> &points, Color color,
+                   BlendMode mode = BlendMode::Opaque) {
+    FillPolygon(points.data(), static_cast<int>(points.size()), color, mode);
+  }
+  void FillEllipse(Point center, int rx, int ry, Color color,
+                   BlendMode mode = BlendMode::Opaque);
+  void FillCircle(Point center, int radius, Color color,
+                  BlendMode mode = BlendMode::Opaque) {
+    FillEllipse(center, radius, radius, color, mode);
+  }
+  void FillRoundedRectangle(Point p1, Point p2, int radius, Color color,
+                            BlendMode mode = BlendMode::Opaque);
   void DrawColorImage(Point pos, const IImage &img) {
     DrawColorImage(pos, img, Rect(Point(0, 0), img.GetSize()));
   }
@@ -98,6 +456,37 @@ public:
   }
   void DrawColorImageMask(Point pos, const IImage &img, Rect imgrect);
 
+
+  // Image drawing with a blend mode. The modes that have their own methods
+  // (see BlendMode.h) draw exactly like those.
+  void DrawColorImage(Point pos, const IImage &img, BlendMode mode) {
+    DrawColorImage(pos, img, mode, Rect(Point(0, 0), img.GetSize()));
+  }
+  void DrawColorImage(Point pos, const IImage &img, BlendMode mode,
+                      Rect imgrect);
+  void DrawMonoImage(Point pos, const IImage &img, Color color,
+                     BlendMode mode) {
+    DrawMonoImage(pos, img, color, mode, Rect(Point(0, 0), img.GetSize()));
+  }
+  void DrawMonoImage(Point pos, const IImage &img, Color color, BlendMode mode,
+                     Rect imgrect);
+
+  // Draws the colors of a row source (see IRowSource.h) with the mode, with
+  // its left-top at pos. This draws like a color image with the mode.
+  void DrawRows(Point pos, const IRowSource &rows,
+                BlendMode mode = BlendMode::Opaque);
+
+  // Masked drawing. These draw like the methods without a mask, but only the
+  // pixels where the mask, with its left-top at maskpos, has a set bit (see
+  // BitMask.h). The mask is drawn as runs of set bits, so its empty areas cost
+  // almost nothing.
+  void DrawColorImage(Point pos, const IImage &img, BlendMode mode,
+                      const BitMask &mask, Point maskpos = Point());
+  void DrawMonoImage(Point pos, const IImage &img, Color color, BlendMode mode,
+                     const BitMask &mask, Point maskpos = Point());
+  void FillMask(const BitMask &mask, Point maskpos, Color color,
+                BlendMode mode = BlendMode::Opaque);
+
   // Modulated drawing for transitions
   void DrawColorImageMod(Point pos, const IImage &img, Color mod) {
     DrawColorImageMod(pos, img, mod, Rect(Point(0, 0), img.GetSize()));
@@ -178,4 +567,18 @@ public:
   }
   void DrawMonoTexturedModAdd(Point pos, const IImage &img, const IImage &tex,
                               Color mod, Point texoffset, Rect imgrect);
+
+  // Transformed drawing for scaling and rotation. The transform maps image
+  // coordinates to canvas coordinates (see Transform.h). Every canvas pixel
+  // of which the center maps back inside the image is drawn with the image
+  // sampled there, stepping through the image in fixed point. Images with mip
+  // levels (see Image::BuildMips) that are drawn at half size or smaller are
+  // sampled from the smallest level that is still at least the drawn size.
+  void DrawColorImageTransformed(const IImage &img, const Transform &transform,
+                                 Sampling sampling = Sampling::Nearest,
+                                 BlendMode mode = BlendMode::Blend);
+  void DrawMonoImageTransformed(const IImage &img, Color color,
+                                const Transform &transform,
+                                Sampling sampling = Sampling::Nearest,
+                                BlendMode mode = BlendMode::Blend);
 };
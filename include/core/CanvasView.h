@@ -0,0 +1,20 @@
+#pragma once
+#include "core/Canvas.h"
+
+/*
+  A CanvasView is a window on an area of another canvas. It has its own origin and size,
+  but draws directly in the buffer of the canvas it views, so an effect can render into
+  a part of the screen without a temporary canvas and without copying the result back.
+  Drawing is clipped to the part of the area that lies within the parent canvas. The area
+  may be partially (or completely) outside the parent, but then the view can only be used
+  as a source image (or through GetBuffer) for the part that lies within the parent.
+  A view can be used anywhere a Canvas can. The parent must not be resized or destroyed
+  while the view exists.
+*/
+class CanvasView final : public Canvas
+{
+public:
+
+	CanvasView(Canvas& parent, Rect area) : Canvas(parent, area) { }
+	CanvasView(Canvas& parent, Point pos, Size size) : Canvas(parent, Rect(pos, size)) { }
+};
@@ -32,7 +32,12 @@ public:
 	Color(byte _r, byte _g, byte _b, byte _a) { r = _r; g = _g; b = _b; a = _a; }
 	Color(Color _c, byte _a) { r = _c.r; g = _c.g; b = _c.b; a = MOD_BYTE_COLOR(_c.a, _a); }
 
-	// TODO: I could probably squeeze some more performance out of the operations below with SIMD instructions
+	// Comparison
+	inline bool operator==(const Color& c) const { return (r == c.r) && (g == c.g) && (b == c.b) && (a == c.a); }
+	inline bool operator!=(const Color& c) const { return !(*this == c); }
+
+	// The operations below work on a single color. For spans of colors, the SIMD versions in
+	// ColorSpan.h are faster.
 
 	// Blends the given color with this color by the amount of alpha in the given color
 	inline void Blend(Color c)
@@ -69,6 +74,95 @@ public:
 		a |= c.a;
 	}
 
+	// Converts this color to premultiplied alpha, where r, g and b are already modulated by the alpha.
+	// Premultiplied colors blend with a single multiply per channel (see BlendPremultiplied).
+	inline void Premultiply()
+	{
+		ModulateRGB(a);
+	}
+
+	// Converts this color from premultiplied alpha back to straight alpha.
+	// This loses precision for low alpha values and the color of fully transparent pixels is lost.
+	inline void Unpremultiply()
+	{
+		if((a == 0) || (a == 255))
+			return;
+		uint ha = static_cast<uint>(a) / 2u;
+		r = static_cast<byte>(std::min((static_cast<uint>(r) * 255u + ha) / a, 255u));
+		g = static_cast<byte>(std::min((static_cast<uint>(g) * 255u + ha) / a, 255u));
+		b = static_cast<byte>(std::min((static_cast<uint>(b) * 255u + ha) / a, 255u));
+	}
+
+	// Blends the given premultiplied color over this premultiplied color. Unlike Blend, this also
+	// composites the alpha, so that layers drawn onto a transparent canvas keep their coverage.
+	inline void BlendPremultiplied(Color c)
+	{
+		uint ia = 255u - static_cast<uint>(c.a);
+		r = static_cast<byte>(std::min(static_cast<uint>(c.r) + DIV_255_FAST(static_cast<uint>(r) * ia), 255u));
+		g = static_cast<byte>(std::min(static_cast<uint>(c.g) + DIV_255_FAST(static_cast<uint>(g) * ia), 255u));
+		b = static_cast<byte>(std::min(static_cast<uint>(c.b) + DIV_255_FAST(static_cast<uint>(b) * ia), 255u));
+		a = static_cast<byte>(std::min(static_cast<uint>(c.a) + DIV_255_FAST(static_cast<uint>(a) * ia), 255u));
+	}
+
+	// Adds the given premultiplied color to this premultiplied color (including the alpha)
+	inline void AddPremultiplied(Color c)
+	{
+		r = static_cast<byte>(std::min(static_cast<uint>(r) + static_cast<uint>(c.r), 255u));
+		g = static_cast<byte>(std::min(static_cast<uint>(g) + static_cast<uint>(c.g), 255u));
+		b = static_cast<byte>(std::min(static_cast<uint>(b) + static_cast<uint>(c.b), 255u));
+		a = static_cast<byte>(std::min(static_cast<uint>(a) + static_cast<uint>(c.a), 255u));
+	}
+
+	// Blend modes. These combine the given color with this color per channel and blend the result
+	// with this color by the amount of alpha in the given color, like Blend. The alpha of this
+	// color remains unchanged.
+
+	// Multiplies the colors, which darkens (white leaves this color unchanged)
+	inline void Multiply(Color c) { ApplyMode(c, [](uint d, uint s) { return DIV_255_FAST(d * s); }); }
+
+	// Multiplies the inverted colors, which lightens (black leaves this color unchanged)
+	inline void Screen(Color c) { ApplyMode(c, [](uint d, uint s) { return d + s - DIV_255_FAST(d * s); }); }
+
+	// Multiplies where this color is dark and screens where it is light, which adds contrast
+	inline void Overlay(Color c) { ApplyMode(c, [](uint d, uint s) { return (d <= 127u) ? 2u * DIV_255_FAST(d * s) : 255u - 2u * DIV_255_FAST((255u - d) * (255u - s)); }); }
+
+	// Takes the lowest or highest value of each channel
+	inline void Darken(Color c) { ApplyMode(c, [](uint d, uint s) { return std::min(d, s); }); }
+	inline void Lighten(Color c) { ApplyMode(c, [](uint d, uint s) { return std::max(d, s); }); }
+
+	// Takes the difference between the values of each channel
+	inline void Difference(Color c) { ApplyMode(c, [](uint d, uint s) { return std::max(d, s) - std::min(d, s); }); }
+
+	// Blend modes for premultiplied colors. These composite the alpha like BlendPremultiplied,
+	// so where this color is transparent the given color is drawn as it is. The modes follow the
+	// W3C compositing formulas, which work on premultiplied colors without dividing.
+	inline void MultiplyPremultiplied(Color c) { ApplyModePremultiplied(c, [](uint d, uint s, uint, uint) { return static_cast<int>(DIV_255_FAST(s * d)); }); }
+	inline void ScreenPremultiplied(Color c) { ApplyModePremultiplied(c, [](uint d, uint s, uint da, uint sa) { return static_cast<int>(DIV_255_FAST(s * da) + DIV_255_FAST(d * sa)) - static_cast<int>(DIV_255_FAST(s * d)); }); }
+	inline void DarkenPremultiplied(Color c) { ApplyModePremultiplied(c, [](uint d, uint s, uint da, uint sa) { return static_cast<int>(std::min(DIV_255_FAST(s * da), DIV_255_FAST(d * sa))); }); }
+	inline void LightenPremultiplied(Color c) { ApplyModePremultiplied(c, [](uint d, uint s, uint da, uint sa) { return static_cast<int>(std::max(DIV_255_FAST(s * da), DIV_255_FAST(d * sa))); }); }
+
+	inline void OverlayPremultiplied(Color c)
+	{
+		ApplyModePremultiplied(c, [](uint d, uint s, uint da, uint sa)
+		{
+			if(2u * d <= da)
+				return static_cast<int>(2u * DIV_255_FAST(s * d));
+			uint id = (da > d) ? da - d : 0u;
+			uint is = (sa > s) ? sa - s : 0u;
+			return static_cast<int>(DIV_255_FAST(sa * da)) - static_cast<int>(2u * DIV_255_FAST(id * is));
+		});
+	}
+
+	inline void DifferencePremultiplied(Color c)
+	{
+		ApplyModePremultiplied(c, [](uint d, uint s, uint da, uint sa)
+		{
+			uint sd = DIV_255_FAST(s * da);
+			uint ds = DIV_255_FAST(d * sa);
+			return static_cast<int>(std::max(sd, ds) - std::min(sd, ds));
+		});
+	}
+
 	// Modulates the brightness of this color by the amount specified (0-255)
 	inline void ModulateRGB(byte m)
 	{
@@ -132,4 +226,35 @@ public:
     {
         return c * scale;
     }
+
+private:
+
+	// Applies a blend mode, where f combines a channel of this color (d) with that of the given color (s)
+	template<typename F>
+	inline void ApplyMode(Color c, F f)
+	{
+		uint ia = 255u - static_cast<uint>(c.a);
+		uint ca = static_cast<uint>(c.a);
+		r = static_cast<byte>(DIV_255_FAST(f(r, c.r) * ca) + DIV_255_FAST(static_cast<uint>(r) * ia));
+		g = static_cast<byte>(DIV_255_FAST(f(g, c.g) * ca) + DIV_255_FAST(static_cast<uint>(g) * ia));
+		b = static_cast<byte>(DIV_255_FAST(f(b, c.b) * ca) + DIV_255_FAST(static_cast<uint>(b) * ia));
+	}
+
+	// Applies a blend mode to premultiplied colors, where f returns the part where both colors
+	// overlap from a channel and the alpha of this color (d, da) and the given color (s, sa)
+	template<typename F>
+	inline void ApplyModePremultiplied(Color c, F f)
+	{
+		uint ia = 255u - static_cast<uint>(c.a);
+		uint ida = 255u - static_cast<uint>(a);
+		auto channel = [&](uint d, uint s)
+		{
+			int v = static_cast<int>(DIV_255_FAST(s * ida) + DIV_255_FAST(d * ia)) + f(d, s, static_cast<uint>(a), static_cast<uint>(c.a));
+			return static_cast<byte>(std::clamp(v, 0, 255));
+		};
+		r = channel(r, c.r);
+		g = channel(g, c.g);
+		b = channel(b, c.b);
+		a = static_cast<byte>(std::min(static_cast<uint>(c.a) + DIV_255_FAST(static_cast<uint>(a) * ia), 255u));
+	}
 };
@@ -0,0 +1,92 @@
+#pragma once
+#include "core/Color.h"
+
+/*
+  Span kernels apply the per-pixel operations of Color to a whole row of pixels at once.
+  They use SSE2/AVX2 on x86 and NEON on ARM when the compiler targets these instruction sets,
+  and fall back to the scalar Color methods otherwise. The results are bit-identical to the
+  scalar DIV_255_FAST math, so it does not matter which path was taken.
+  The destination and source spans may not partially overlap (identical pointers are fine).
+*/
+
+// The span kernels that draw a single color, for choosing one at runtime
+typedef void (*ColorSpanFunction)(Color* dst, Color c, int count);
+
+// Writes the color to the destination pixels
+void FillSpan(Color* dst, Color c, int count);
+
+// Blends the source pixels onto the destination pixels (see Color::Blend)
+void BlendSpan(Color* dst, const Color* src, int count);
+void BlendSpan(Color* dst, Color c, int count);
+
+// Adds the source pixels to the destination pixels (see Color::Add)
+void AddSpan(Color* dst, const Color* src, int count);
+void AddSpan(Color* dst, Color c, int count);
+
+// Masks the source pixels onto the destination pixels (see Color::Mask)
+void MaskSpan(Color* dst, const Color* src, int count);
+void MaskSpan(Color* dst, Color c, int count);
+
+// Blends premultiplied source pixels onto premultiplied destination pixels (see Color::BlendPremultiplied)
+void BlendPremultipliedSpan(Color* dst, const Color* src, int count);
+void BlendPremultipliedSpan(Color* dst, Color c, int count);
+
+// Adds premultiplied source pixels to premultiplied destination pixels (see Color::AddPremultiplied)
+void AddPremultipliedSpan(Color* dst, const Color* src, int count);
+void AddPremultipliedSpan(Color* dst, Color c, int count);
+
+// Combines the source pixels with the destination pixels by a blend mode (see Color::Multiply and
+// so on) and the premultiplied source pixels with premultiplied destination pixels (see
+// Color::MultiplyPremultiplied and so on)
+void MultiplySpan(Color* dst, const Color* src, int count);
+void MultiplySpan(Color* dst, Color c, int count);
+void MultiplyPremultipliedSpan(Color* dst, const Color* src, int count);
+void MultiplyPremultipliedSpan(Color* dst, Color c, int count);
+void ScreenSpan(Color* dst, const Color* src, int count);
+void ScreenSpan(Color* dst, Color c, int count);
+void ScreenPremultipliedSpan(Color* dst, const Color* src, int count);
+void ScreenPremultipliedSpan(Color* dst, Color c, int count);
+void OverlaySpan(Color* dst, const Color* src, int count);
+void OverlaySpan(Color* dst, Color c, int count);
+void OverlayPremultipliedSpan(Color* dst, const Color* src, int count);
+void OverlayPremultipliedSpan(Color* dst, Color c, int count);
+void DarkenSpan(Color* dst, const Color* src, int count);
+void DarkenSpan(Color* dst, Color c, int count);
+void DarkenPremultipliedSpan(Color* dst, const Color* src, int count);
+void DarkenPremultipliedSpan(Color* dst, Color c, int count);
+void LightenSpan(Color* dst, const Color* src, int count);
+void LightenSpan(Color* dst, Color c, int count);
+void LightenPremultipliedSpan(Color* dst, const Color* src, int count);
+void LightenPremultipliedSpan(Color* dst, Color c, int count);
+void DifferenceSpan(Color* dst, const Color* src, int count);
+void DifferenceSpan(Color* dst, Color c, int count);
+void DifferencePremultipliedSpan(Color* dst, const Color* src, int count);
+void DifferencePremultipliedSpan(Color* dst, Color c, int count);
+
+// Writes the source pixels converted to premultiplied or straight alpha to the destination
+// (see Color::Premultiply and Color::Unpremultiply)
+void PremultiplySpan(Color* dst, const Color* src, int count);
+void UnpremultiplySpan(Color* dst, const Color* src, int count);
+
+// Writes the source pixels modulated by the given color or amount to the destination (see Color::ModulateRGBA)
+void ModulateSpan(Color* dst, const Color* src, Color mod, int count);
+void ModulateSpan(Color* dst, const Color* src, byte m, int count);
+
+// Writes the palette colors selected by the indices to the destination (one index per pixel)
+void LookupSpan(Color* dst, const byte* indices, const Color* palette, int count);
+
+// Writes count pixels which each are the rounded average of 2 x 2 source pixels: pixel i is the
+// average of pixels 2 * i and 2 * i + 1 on both source rows. This halves images (see
+// Image::BuildMips), colors must have premultiplied alpha to be averaged correctly.
+void HalveSpan(Color* dst, const Color* row0, const Color* row1, int count);
+void HalveSpan(byte* dst, const byte* row0, const byte* row1, int count);
+
+// Writes count pixels from separate planes of red, green, blue and alpha, of which the values go
+// from 0 to 1 (see PlanarCanvas). Values are rounded to the nearest byte and limited to 0 to 255,
+// not-a-number becomes 0.
+void InterleaveSpan(Color* dst, const float* r, const float* g, const float* b, const float* a, int count);
+
+// Returns a hash of the pixels. This is CRC32C when the CPU has an instruction for it (SSE 4.2 or
+// the ARMv8 CRC extension), otherwise a multiplicative hash, so hashes may only be compared with
+// hashes from the same build.
+uint32_t HashSpan(const Color* src, int count);
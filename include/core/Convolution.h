@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include "core/Canvas.h"
+#include "core/Image.h"
+
+/*
+  Convolution filters for Canvas and Image. The filters are separable: a horizontal pass over
+  the rows and a vertical pass over the columns, which costs 2 * n taps per pixel instead of
+  n * n. Box blurs keep a running sum, so that they cost the same for any radius, and the
+  Gaussian blur is approximated by three box blurs.
+  Canvas filters work on the clip rectangle (so also on views), Image filters on the whole
+  image. Pixels outside the area count as copies of the nearest pixel on the edge. All channels
+  are filtered as they are stored, so blurring straight alpha colors lets transparent colors
+  bleed into their neighbors; premultiplied pixels blur correctly. Monochrome images are
+  filtered as coverage. After filtering an image, build its mip levels again.
+  The filters keep their scratch buffers, so that filtering every frame does not allocate
+  every frame. Filters are not recorded by a recording canvas, they apply right away.
+*/
+class Convolution final
+{
+private:
+
+	// The pixels a filter works on. Rows are stride bytes apart and every pixel has
+	// channels bytes (4 for colors with alpha last, 1 for coverage).
+	struct Area
+	{
+		byte* data;
+		int width;
+		int height;
+		int stride;
+		int channels;
+		bool premultiplied;
+	};
+
+	// Row with copies of the edge pixels on both sides, for the horizontal passes
+	PixelBuffer<byte> line;
+
+	// Copy of the area, for the vertical passes which read the rows they replace
+	PixelBuffer<byte> copy;
+
+	// The area before blurring, for Sharpen and DetectEdges
+	PixelBuffer<byte> original;
+
+	// Running sums (or weighted sums) of a row of pixels, per channel
+	PixelBuffer<int> sums;
+
+	// Returns the area of the canvas or image to filter
+	static Area GetArea(Canvas& canvas);
+	static Area GetArea(Image& img);
+
+	// Filters the clip rectangle of the canvas with f(area) and adds it to the damage, or the
+	// image when it is not empty
+	template<typename F> void Filter(Canvas& canvas, F f);
+	template<typename F> void Filter(Image& img, F f);
+
+	// Passes over an area
+	void BoxRows(const Area& area, int radius);
+	void BoxColumns(const Area& area, int radius);
+	void KernelRows(const Area& area, const int* weights, int taps, int divisor);
+	void KernelColumns(const Area& area, const int* weights, int taps, int divisor);
+
+	// Filters made of passes
+	void Box(const Area& area, int radius);
+	void Gaussian(const Area& area, float sigma);
+	void Unsharp(const Area& area, int radius, float amount, bool edges);
+
+public:
+
+	// Box blur, every pixel becomes the average of the square of pixels around it, which is
+	// 2 * radius + 1 pixels wide
+	void BoxBlur(Canvas& canvas, int radius);
+	void BoxBlur(Image& img, int radius);
+
+	// Gaussian blur with the given standard deviation in pixels, approximated by three box
+	// blurs of which the sizes give the same variance
+	void GaussianBlur(Canvas& canvas, float sigma);
+	void GaussianBlur(Image& img, float sigma);
+
+	// Applies a kernel to the rows (horizontal) or columns (vertical). The kernel has an odd
+	// number of integer weights, centered on the pixel, and the weighted sum is divided by the
+	// divisor. Results are limited to 0 to 255 (and to alpha with premultiplied colors), so
+	// apply kernels with negative weights in one pass, not as separate row and column passes.
+	void ConvolveRows(Canvas& canvas, const std::vector<int>& weights, int divisor);
+	void ConvolveRows(Image& img, const std::vector<int>& weights, int divisor);
+	void ConvolveColumns(Canvas& canvas, const std::vector<int>& weights, int divisor);
+	void ConvolveColumns(Image& img, const std::vector<int>& weights, int divisor);
+
+	// Unsharp masking, every pixel moves away from the box blur of the given radius by amount
+	// times their difference. Radius 1 with amount 9 is the classic 3 x 3 sharpen kernel.
+	// Alpha is not changed.
+	void Sharpen(Canvas& canvas, float amount = 1.0f, int radius = 1);
+	void Sharpen(Image& img, float amount = 1.0f, int radius = 1);
+
+	// Every pixel becomes the difference with the box blur of the given radius, scaled by the
+	// size of the box. Radius 1 is the classic 3 x 3 edge kernel (8 times the pixel minus its
+	// neighbors) as an absolute value, except for rounding. Alpha is not changed.
+	void DetectEdges(Canvas& canvas, int radius = 1);
+	void DetectEdges(Image& img, int radius = 1);
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "utils/Tools.h"
+#include "core/Rect.h"
+
+/*
+  Damage keeps track of which part of a canvas has been drawn to. It stores one span per row,
+  from the leftmost to the rightmost damaged pixel on that row. This is cheap to update from
+  the drawing methods and matches how the displays are updated, which is row by row.
+  All coordinates must be within the size of the damage, there is no clipping.
+*/
+class Damage final
+{
+private:
+
+	// Size of the area we track
+	int width;
+	int height;
+
+	// Damaged span on each row (inclusive). The row is clean when left > right.
+	std::vector<int> left;
+	std::vector<int> right;
+
+	// Damaged rows (inclusive). Nothing is damaged when top > bottom.
+	int top;
+	int bottom;
+
+public:
+
+	Damage();
+
+	// Resize the tracked area, which also clears the damage
+	void Resize(int w, int h);
+
+	// Clears the damage
+	void Clear();
+
+	// Adds damage
+	void AddAll();
+	void AddRect(int x1, int y1, int x2, int y2);
+	void Add(const Damage& other);
+	inline void AddPixel(int x, int y)
+	{
+		left[y] = std::min(left[y], x);
+		right[y] = std::max(right[y], x);
+		top = std::min(top, y);
+		bottom = std::max(bottom, y);
+	}
+
+	// Properties
+	inline int Width() const { return width; }
+	inline int Height() const { return height; }
+	inline bool IsEmpty() const { return top > bottom; }
+	inline int Top() const { return top; }
+	inline int Bottom() const { return bottom; }
+	inline bool IsRowDamaged(int y) const { return left[y] <= right[y]; }
+	inline int RowLeft(int y) const { return left[y]; }
+	inline int RowRight(int y) const { return right[y]; }
+
+	// Returns the rectangle that contains all damage
+	Rect Bounds() const;
+};
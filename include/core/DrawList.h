@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include "utils/Tools.h"
+#include "core/Blitter.h"
+#include "core/Rect.h"
+#include "core/Transform.h"
+#include "core/BlendMode.h"
+
+class Canvas;
+
+/*
+  A draw list holds recorded Canvas drawing calls (see Canvas::BeginRecording), so that they
+  can be drawn later, as often as needed, without making the calls again. This is useful for
+  static content that is drawn every frame.
+  While recording, the list groups the calls into batches which share the image, texture,
+  colors and clip area. Such a batch is drawn with a single setup of the source, instead of
+  one per call, which helps text where every character is a separate call. A call may only
+  join an earlier batch when nothing it draws over was drawn after that batch, so the result
+  is the same as drawing the calls in the order they were recorded.
+  The list only keeps pointers to the images and row sources, they must outlive the list. They
+  are drawn as they are when the list is drawn.
+*/
+
+// The drawing methods of Canvas that can be recorded
+enum class DrawOp : byte
+{
+	Clear,
+	Line,
+	LineBlend,
+	Rectangle,
+	ColorImageTransformed,
+	MonoImageTransformed,
+	FillPolygon,
+	FillEllipse,
+	FillRoundedRectangle,
+	ColorImage,
+	ColorImageBlend,
+	ColorImageAdd,
+	ColorImageMask,
+	ColorImageMode,
+	ColorImageMod,
+	MonoImage,
+	MonoImageBlend,
+	MonoImageAdd,
+	MonoImageMask,
+	MonoImageMode,
+	MonoTextured,
+	MonoTexturedMask,
+	MonoTexturedBlend,
+	MonoTexturedAdd,
+	MonoTexturedMod,
+	MonoTexturedModMask,
+	MonoTexturedModBlend,
+	MonoTexturedModAdd,
+	RowsMode
+};
+
+// A recorded drawing call. Coordinates are on the canvas that owns the buffer.
+struct DrawCommand
+{
+	DrawOp op = DrawOp::Clear;
+	const IImage* img = nullptr;	// Image (image drawing only)
+	const IImage* tex = nullptr;	// Texture (textured drawing only)
+	const IRowSource* rows = nullptr;	// Row source (row source drawing only)
+	Color color;					// Drawing, modulation, clear or line color
+	Color fillcolor;				// Fill color (rectangles only)
+	Point texoffset;				// Texture offset (textured drawing only)
+	Rect clip;						// Clip area at the time of recording
+	Point pos;						// Image position, the first point of lines and rectangles, or the left-top of transformed drawing and fills
+	Point pos2;						// Second point of lines and rectangles, or the right-bottom of transformed drawing and fills
+	Rect imgrect;					// Image rectangle (image drawing only)
+	Transform transform;			// Transformation (transformed drawing only)
+	Point origin;					// Where the transformation places (0, 0) (transformed drawing only)
+	Sampling sampling = Sampling::Nearest;	// Sampling (transformed drawing only)
+	BlendMode mode = BlendMode::Opaque;		// Blend mode (rectangles, fills, transformed drawing, image drawing with a mode and row sources)
+	int radius = 0;					// Corner radius (rounded rectangles only)
+	std::vector<Point> points;		// Vertices (polygons only)
+
+	inline bool IsImageDraw() const { return op >= DrawOp::ColorImage; }
+
+	// Returns true when the commands only differ in where they draw
+	bool IsSameState(const DrawCommand& other) const;
+};
+
+class DrawList final
+{
+private:
+
+	// Commands that are drawn together. For image drawing, the items are the positions
+	// and image rectangles of the commands. Other commands are never batched.
+	struct Batch
+	{
+		DrawCommand state;
+		std::vector<BlitItem> items;
+
+		// The area the commands draw in (inclusive coordinates)
+		int left;
+		int top;
+		int right;
+		int bottom;
+	};
+
+	// Batches in the order they are drawn
+	std::vector<Batch> batches;
+	int commandcount;
+
+public:
+
+	DrawList();
+
+	// Removes all commands
+	void Clear();
+
+	// Adds a command, this is called by the canvas while recording
+	void Add(const DrawCommand& command);
+
+	// Draws all commands on the canvas
+	void Execute(Canvas& canvas) const;
+
+	// Properties
+	inline bool IsEmpty() const { return batches.empty(); }
+	inline int CommandCount() const { return commandcount; }
+	inline int BatchCount() const { return static_cast<int>(batches.size()); }
+};
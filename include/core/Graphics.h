@@ -2,6 +2,7 @@
 #include "utils/Configuration.h"
 #include "core/IRenderer.h"
 #include "core/Canvas.h"
+#include "core/BandRenderer.h"
 #include "platform/IGraphicsHAL.h"
 
 class Graphics final
@@ -20,6 +21,9 @@ private:
 	// Multiple renderers can modify the canvas in the order they were added.
 	vector<IRenderer*> renderers;
 
+	// Renders band-safe renderers on multiple threads when enabled (see BandRenderer.h)
+	BandRenderer* bandrenderer;
+
 	// FPS measuring
 	bool showfps;
 	TimePoint nextfpstime;
@@ -28,6 +32,9 @@ private:
 	// Recording
 	String recordpath;
 	vector<byte> recordbuffer;
+	PixelBuffer<Color> recordpixels;
+	vector<uint32_t> recordhashes;
+	Damage recordchanges;
 	TimePoint nextrecordtime;
 	ch::microseconds recordinterval;
 	int frameindex;
@@ -52,6 +59,7 @@ public:
     int GetKey() { return hal->GetKeyPress(); }
 	void Record(String path);
 
-	// This renders the canvas and displays it
+	// This renders the canvas and displays it. The canvas is cleared first when clear is set,
+	// unless the first renderer covers the frame (see IRenderer::CoversFrame).
 	void Present(bool clear = true);
 };
@@ -1,4 +1,18 @@
 #pragma once
+
+// The display geometry is either configured at runtime (Display.Width, Display.Height
+// and Display.Panels) or fixed at compile time with the FIXED_DISPLAY_GEOMETRY CMake option.
+// With a fixed geometry these are constant expressions, so that loops bounded by them (like
+// the row loops in the Present of the platform graphics) can be unrolled and vectorized by the
+// compiler. Code that takes its size from a Canvas is not affected.
+#ifdef FIXED_DISPLAY_GEOMETRY
+constexpr int DISPLAY_WIDTH = FIXED_DISPLAY_WIDTH;
+constexpr int DISPLAY_HEIGHT = FIXED_DISPLAY_HEIGHT;
+constexpr int DISPLAY_PANELS = FIXED_DISPLAY_PANELS;
+static_assert((DISPLAY_WIDTH > 0) && (DISPLAY_HEIGHT > 0) && (DISPLAY_PANELS > 0), "Invalid display geometry");
+static_assert((DISPLAY_WIDTH % DISPLAY_PANELS) == 0, "Display width must be a multiple of the number of panels");
+#else
 extern int DISPLAY_WIDTH;
 extern int DISPLAY_HEIGHT;
 extern int DISPLAY_PANELS;
+#endif
@@ -16,6 +16,7 @@ public:
 
 	// Methods
 	virtual bool HasColors() const = 0;
+	virtual bool IsPremultiplied() const = 0;		// Colors have premultiplied alpha (see Color::Premultiply)
 	virtual int Width() const = 0;
 	virtual int Height() const = 0;
 	virtual Size GetSize() const = 0;
@@ -23,4 +24,10 @@ public:
 	virtual const Color* ColorData() const = 0;
 	virtual MonoSampler GetMonoSampler() const = 0;
 	virtual ColorSampler GetColorSampler() const = 0;
+
+	// Mip levels are smaller versions of the image for drawing it scaled down (see
+	// Image::BuildMips). Level 0 is the image itself, every next level is half the size of the
+	// previous one. Images without mip levels only have level 0.
+	virtual int MipCount() const { return 1; }
+	virtual const IImage& GetMip(int) const { return *this; }
 };
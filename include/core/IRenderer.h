@@ -14,4 +14,16 @@ public:
 
 	// Methods
 	virtual void Render(Canvas& canvas) = 0;
+
+	// Returns true when this renderer may render horizontal bands of the frame at the same time
+	// on multiple threads (see BandRenderer.h). Render then gets a view of the whole canvas that is
+	// clipped to one band, and it should only do the work for the clip area (see Canvas::GetClip).
+	// Render must only draw through the given canvas and must not change shared state, because it
+	// runs on the bands at the same time.
+	virtual bool IsBandSafe() const { return false; }
+
+	// Returns true when Render writes every pixel of the canvas without blending, so that nothing
+	// of what was on the canvas before remains. When the first renderer covers the frame,
+	// Graphics::Present does not clear the canvas first.
+	virtual bool CoversFrame() const { return false; }
 };
@@ -0,0 +1,34 @@
+#pragma once
+#include "core/Color.h"
+#include "core/Size.h"
+
+/*
+  A row source produces rows of colors to draw on a Canvas, like an image, but computes them
+  from its own pixel format instead of holding colors (see IndexedCanvas, AccumulationCanvas
+  and PlanarCanvas). Canvas::DrawRows draws it through the blitter, so clipping, conversion
+  between straight and premultiplied alpha, recording and damage work as with images.
+*/
+class IRowSource
+{
+	// Make this an interface, do not allow instantiation
+public:
+	virtual ~IRowSource() = default;
+protected:
+	IRowSource() { }
+	IRowSource(const IRowSource&) { }
+	IRowSource& operator = (const IRowSource&) { return *this; }
+public:
+
+	// Methods
+	virtual Size GetSize() const = 0;
+	virtual bool IsPremultiplied() const = 0;		// Colors have premultiplied alpha (see Color::Premultiply)
+
+	// Returns true when all colors are opaque, so that they are the same with straight and
+	// premultiplied alpha and never need to be converted
+	virtual bool IsOpaque() const { return false; }
+
+	// Returns count colors of row y from column x on. The colors are produced in scratch, which
+	// has room for BLIT_CHUNK_SIZE colors, or the returned pointer points at them directly.
+	// The row has been clipped to the size already.
+	virtual const Color* Row(int x, int y, int count, Color* scratch) const = 0;
+};
@@ -1,4 +1,6 @@
 #pragma once
+#include <memory>
+#include <vector>
 #include "utils/Tools.h"
 #include "core/Color.h"
 #include "core/Size.h"
@@ -10,30 +12,57 @@ private:
 
 	// Fields
 	bool hascolors;
+	bool premultiplied;
 	int width;
 	int height;
 	byte* data;
 
+	// Mip levels 1 and up (see BuildMips)
+	std::vector<std::unique_ptr<Image>> mips;
+
+	friend class Convolution;
+
+	// Size of the data in bytes
+	inline size_t DataSize() const { return static_cast<size_t>(width) * height * (hascolors ? 4 : 1); }
+
 public:
 
 	Image();
-	Image(const String& filename);
+	Image(const String& filename, bool premultiply = false, bool buildmips = false);
     Image(int w, int h); // New
 	virtual ~Image();
 
-	// Loading
-	void Load(const String& filename);
+	// Loading. With premultiply the colors are converted to premultiplied alpha once here,
+	// so that they can be drawn on a premultiplied canvas without conversion. With buildmips
+	// the mip levels are built (see BuildMips). DDS files load the mip levels they contain.
+	void Load(const String& filename, bool premultiply = false, bool buildmips = false);
 	void Unload();
+
+	// Builds the mip levels, down to a single pixel. Every level is the previous one at half
+	// the size (rounded down), with every pixel the average of 2 x 2 pixels. Transformed
+	// drawing then draws the level nearest to the drawn size (see Canvas::DrawColorImageTransformed),
+	// so that scaling down does not alias. Build them again after changing the pixels.
+	void BuildMips();
     
     // Manual data setting (for GIFs etc)
-    void SetPixel(int x, int y, Color c); // New
-    void SetData(int w, int h, bool hasColor, byte* newData);
+    void SetPixel(int x, int y, Color c); // Takes a straight alpha color
+    void SetData(int w, int h, bool hasColor, byte* newData, bool premultiply = false);
+
+	// Converts the colors to premultiplied alpha (does nothing when already premultiplied)
+	void Premultiply();
 
 	// Properties
 	virtual bool HasColors() const override final { return hascolors; }
+	virtual bool IsPremultiplied() const override final { return premultiplied; }
 	virtual int Width() const override final { return width; }
 	virtual int Height() const override final { return height; }
 	virtual Size GetSize() const override final { return Size(width, height); }
+	virtual int MipCount() const override final { return static_cast<int>(mips.size()) + 1; }
+	virtual const IImage& GetMip(int level) const override final
+	{
+		REQUIRE((level >= 0) && (level <= static_cast<int>(mips.size())));
+		return (level == 0) ? *this : *mips[level - 1];
+	}
 
 	virtual const byte* ByteData() const override final
 	{
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Pixel buffers start on a cache line, so that SIMD code may use aligned loads and rows of
+// buffers with an aligned stride never straddle more cache lines than needed
+static constexpr size_t PIXEL_ALIGNMENT = 64;
+
+/*
+  The pixel allocator hands out the buffers of canvases, images and the scratch buffers of the
+  drawing code. Buffers are aligned to PIXEL_ALIGNMENT. Sizes are rounded up to size classes
+  (four per power of two, so at most a quarter is unused) and freed buffers are kept on a free
+  list per class, so that effects which make a temporary canvas or image every frame get the
+  buffer of the previous frame back instead of going through malloc. The free lists keep a
+  limited amount of memory, buffers beyond that go back to the system.
+  Optionally, large buffers are backed by huge pages (see SetHugePages), so that sweeping over
+  them needs far fewer TLB entries. This is a hint to the kernel, which uses normal pages when
+  it has no huge pages available.
+  The allocator may be used from multiple threads.
+*/
+class PixelAllocator final
+{
+public:
+
+	// Returns a buffer of at least size bytes, aligned to PIXEL_ALIGNMENT, or nullptr when the
+	// size is 0. The size must be passed to Free again.
+	static void* Allocate(size_t size);
+
+	// Gives back a buffer from Allocate, of the size it was allocated with
+	static void Free(void* ptr, size_t size);
+
+	// Enables huge pages for buffers allocated from now on, of at least the huge page size
+	// (2 MB). Only supported on Linux, elsewhere this does nothing.
+	static void SetHugePages(bool enable);
+
+	// Gives the buffers on the free lists back to the system
+	static void Trim();
+};
+
+// Allocator for standard containers, which allocates from the pixel allocator
+template<typename T> class PixelBufferAllocator
+{
+public:
+
+	using value_type = T;
+
+	PixelBufferAllocator() = default;
+	template<typename U> PixelBufferAllocator(const PixelBufferAllocator<U>&) { }
+
+	T* allocate(size_t n)
+	{
+		void* ptr = PixelAllocator::Allocate(n * sizeof(T));
+		if((ptr == nullptr) && (n > 0))
+			throw std::bad_alloc();
+		return static_cast<T*>(ptr);
+	}
+
+	void deallocate(T* ptr, size_t n) { PixelAllocator::Free(ptr, n * sizeof(T)); }
+
+	template<typename U> bool operator == (const PixelBufferAllocator<U>&) const { return true; }
+	template<typename U> bool operator != (const PixelBufferAllocator<U>&) const { return false; }
+};
+
+// A vector of which the data comes from the pixel allocator
+template<typename T> using PixelBuffer = std::vector<T, PixelBufferAllocator<T>>;
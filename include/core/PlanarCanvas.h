@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include "core/Canvas.h"
+#include "core/IRowSource.h"
+
+// Rows of a planar canvas are padded to a multiple of this many values, which is the number of
+// floats in the widest vectors (AVX)
+static constexpr int PLANAR_VECTOR_WIDTH = 8;
+
+/*
+  A planar canvas stores every channel in its own plane of floats from 0 to 1, instead of
+  interleaved in Color structs. Effects that compute the channels separately, like shaders
+  working on float vectors, can store a vector of red values, a vector of green values and so on
+  straight into the planes, without shuffling them into pixels. Rows are padded to a multiple
+  of PLANAR_VECTOR_WIDTH values, so a row can be written in whole vectors without checking the
+  width. The planes are converted to pixels when the canvas is drawn onto a Canvas (see DrawTo),
+  which rounds the values to bytes and interleaves them in vectors, a row at a time as a row
+  source (see IRowSource.h).
+  The colors have straight alpha, like the colors given to Canvas.
+*/
+class PlanarCanvas final : public IRowSource
+{
+private:
+
+	// The red, green, blue and alpha planes after each other, each height rows of stride values
+	PixelBuffer<float> planes;
+	int width;
+	int height;
+	int stride;
+
+public:
+
+	// Constructor. The default constructor makes a canvas the size of the display.
+	PlanarCanvas();
+	PlanarCanvas(int width, int height);
+
+	// Properties
+	inline int Width() const { return width; }
+	inline int Height() const { return height; }
+	virtual Size GetSize() const override { return Size(width, height); }
+	inline bool IsInBounds(int x, int y) const { return (x >= 0) && (y >= 0) && (x < width) && (y < height); }
+
+	// Number of values in a row, which is the width rounded up to PLANAR_VECTOR_WIDTH
+	inline int Stride() const { return stride; }
+
+	// Returns row y of the plane of a channel (0 to 3 for red, green, blue and alpha). The row
+	// has Stride() values, the ones past the width are not drawn.
+	inline float* GetRow(int channel, int y) { return &planes[(static_cast<size_t>(channel) * height + y) * stride]; }
+	inline const float* GetRow(int channel, int y) const { return &planes[(static_cast<size_t>(channel) * height + y) * stride]; }
+
+	// Changes the size, which sets all pixels to transparent black
+	void Resize(int width, int height);
+
+	// Pixels
+	void Clear(Color color);
+	inline void SetPixel(int x, int y, float r, float g, float b, float a = 1.0f)
+	{
+		if(!IsInBounds(x, y))
+			return;
+		GetRow(0, y)[x] = r;
+		GetRow(1, y)[x] = g;
+		GetRow(2, y)[x] = b;
+		GetRow(3, y)[x] = a;
+	}
+
+	// Draws the pixels with the mode on the canvas, with the left-top of this canvas at pos.
+	// The planes are interleaved into pixels with InterleaveSpan (see ColorSpan.h).
+	inline void DrawTo(Canvas& canvas, Point pos = Point(), BlendMode mode = BlendMode::Opaque) const { canvas.DrawRows(pos, *this, mode); }
+
+	// Row source
+	virtual bool IsPremultiplied() const override { return false; }
+	virtual const Color* Row(int x, int y, int count, Color* scratch) const override;
+};
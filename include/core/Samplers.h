@@ -19,6 +19,7 @@ struct MonoSampler
 	public:
 		MonoSampler(const byte* _data, int _width) : data(_data), width(_width) {}
 		inline byte operator() (int x, int y) const { return data[y * width + x]; }
+		inline const byte* Pointer(int x, int y) const { return data + y * width + x; }
 };
 
 // A sampler to get pixels from a color data block
@@ -31,4 +32,5 @@ private:
 public:
 	ColorSampler(const Color* _data, int _width) : data(_data), width(_width) {}
 	inline Color operator() (int x, int y) const { return data[y * width + x]; }
+	inline const Color* Pointer(int x, int y) const { return data + y * width + x; }
 };
@@ -0,0 +1,72 @@
+#pragma once
+#include <cmath>
+#include "utils/Tools.h"
+
+/*
+  A 2D affine transformation, which maps (x, y) to (a * x + b * y + tx, c * x + d * y + ty).
+  This is used to draw scaled and rotated images (see Canvas::DrawColorImageTransformed).
+  Coordinates are continuous: pixel (x, y) covers the area from (x, y) to (x + 1, y + 1),
+  so its center is at (x + 0.5, y + 0.5).
+*/
+
+// How a transformed image is sampled
+enum class Sampling : byte
+{
+	Nearest,	// The pixel nearest to the sample position (blocky, fastest)
+	Bilinear	// Interpolated between the 4 pixels around the sample position (smooth)
+};
+
+struct Transform
+{
+public:
+
+	// Fields
+	float a;
+	float b;
+	float c;
+	float d;
+	float tx;
+	float ty;
+
+	// Constructors
+	Transform() { a = 1.0f; b = 0.0f; c = 0.0f; d = 1.0f; tx = 0.0f; ty = 0.0f; }
+	Transform(float _a, float _b, float _c, float _d, float _tx, float _ty) { a = _a; b = _b; c = _c; d = _d; tx = _tx; ty = _ty; }
+
+	static Transform Translation(float x, float y) { return Transform(1.0f, 0.0f, 0.0f, 1.0f, x, y); }
+	static Transform Scale(float sx, float sy) { return Transform(sx, 0.0f, 0.0f, sy, 0.0f, 0.0f); }
+
+	// Clockwise rotation (because y points down) around the origin
+	static Transform Rotation(float radians)
+	{
+		float cs = std::cos(radians);
+		float sn = std::sin(radians);
+		return Transform(cs, -sn, sn, cs, 0.0f, 0.0f);
+	}
+
+	// Returns the transformation that applies t first and then this one
+	inline Transform operator*(const Transform& t) const
+	{
+		return Transform(
+			a * t.a + b * t.c, a * t.b + b * t.d,
+			c * t.a + d * t.c, c * t.b + d * t.d,
+			a * t.tx + b * t.ty + tx, c * t.tx + d * t.ty + ty);
+	}
+
+	// Methods
+	inline float MapX(float x, float y) const { return a * x + b * y + tx; }
+	inline float MapY(float x, float y) const { return c * x + d * y + ty; }
+
+	// A transformation that collapses the plane onto a line or point has no inverse
+	inline bool IsInvertible() const { return (a * d - b * c) != 0.0f; }
+
+	// Returns the transformation that undoes this one (which must be invertible)
+	inline Transform Inverse() const
+	{
+		float det = a * d - b * c;
+		float ia = d / det;
+		float ib = -b / det;
+		float ic = -c / det;
+		float id = a / det;
+		return Transform(ia, ib, ic, id, -(ia * tx + ib * ty), -(ic * tx + id * ty));
+	}
+};
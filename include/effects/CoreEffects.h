@@ -1,6 +1,7 @@
 #pragma once
 #include "IEffect.h"
 #include "core/Color.h"
+#include "core/IndexedCanvas.h"
 
 namespace libled {
 
@@ -12,6 +13,7 @@ private:
 public:
     SolidColorEffect(Color c) : color(c) {}
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
     void SetColor(Color c) { color = c; }
 };
 
@@ -33,6 +35,7 @@ public:
         : startColor(start), endColor(end), type(type) {}
         
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
     
     void SetColors(Color start, Color end) { startColor = start; endColor = end; }
 };
@@ -41,6 +44,21 @@ class PlasmaEffect : public IEffect
 {
 public:
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
+};
+
+// Plasma by palette cycling. The plasma pattern is drawn once on an indexed canvas and only the
+// palette moves, so a frame costs 256 palette writes and one palette lookup per pixel.
+class PalettePlasmaEffect : public IEffect
+{
+private:
+    IndexedCanvas plasma;
+    std::array<Color, 256> colors;
+
+public:
+    PalettePlasmaEffect();
+    virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
 };
 
 class CompositeEffect : public IEffect
@@ -56,6 +74,9 @@ public:
     void ClearEffects();
 
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+
+    // The composite covers the frame when the bottom effect does
+    virtual bool CoversFrame() const override;
 };
 
 }
@@ -0,0 +1,33 @@
+#pragma once
+#include "IEffect.h"
+#include "core/IRenderer.h"
+#include <memory>
+
+namespace libled {
+
+/**
+ * EffectRenderer - Renders an effect as a renderer of Graphics, so that the effect is rendered
+ * by Graphics::Present. This is how band-safe effects get rendered in bands on multiple threads
+ * (see Graphics.RenderBands), and how effects that cover the frame skip the clear.
+ * Set the effect and the time before every Present.
+ */
+class EffectRenderer : public IRenderer
+{
+private:
+    std::shared_ptr<IEffect> effect;
+    uint32_t timeMs;
+
+public:
+    EffectRenderer() : timeMs(0) {}
+    EffectRenderer(std::shared_ptr<IEffect> fx) : effect(fx), timeMs(0) {}
+
+    inline void SetEffect(std::shared_ptr<IEffect> fx) { effect = fx; }
+    inline std::shared_ptr<IEffect> GetEffect() const { return effect; }
+    inline void SetTime(uint32_t t) { timeMs = t; }
+
+    virtual void Render(Canvas& canvas) override { if (effect) effect->Render(canvas, timeMs); }
+    virtual bool IsBandSafe() const override { return effect && effect->IsBandSafe(); }
+    virtual bool CoversFrame() const override { return effect && effect->CoversFrame(); }
+};
+
+}
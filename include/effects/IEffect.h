@@ -18,6 +18,24 @@ public:
     
     // Optional: Set duration/check if finished
     virtual bool IsFinished() const { return false; }
+
+	// Optional: Returns true when Render writes every pixel of the canvas without blending, so
+	// that the canvas does not need to be cleared before rendering the effect.
+	virtual bool CoversFrame() const { return false; }
+
+	// Optional: Returns true when Render may be called for horizontal bands of the frame at the
+	// same time on multiple threads (see IRenderer::IsBandSafe and EffectRenderer.h).
+	virtual bool IsBandSafe() const { return false; }
 };
 
+// Sizes an offscreen canvas to match the target canvas and clears it. The offscreen canvas
+// also stores its pixels like the target does, so that it can be drawn there without conversion.
+inline void PrepareOffscreen(Canvas& offscreen, const Canvas& target, Color clearcolor = Color(0,0,0,0))
+{
+	if ((offscreen.Width() != target.Width()) || (offscreen.Height() != target.Height()))
+		offscreen.Resize(target.Width(), target.Height());
+	offscreen.SetPremultiplied(target.IsPremultiplied());
+	offscreen.Clear(clearcolor);
+}
+
 }
@@ -18,6 +18,7 @@ public:
         : source(src), speedX(sx), speedY(sy), posX(0), posY(0), lastUpdate(0) {}
         
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return source != nullptr; }
     
     void SetSpeed(int sx, int sy) { speedX = sx; speedY = sy; }
 };
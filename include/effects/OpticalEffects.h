@@ -1,5 +1,6 @@
 #pragma once
 #include "IEffect.h"
+#include "core/Convolution.h"
 
 namespace libled {
 
@@ -24,12 +25,17 @@ public:
     void SetBrightness(float b) { brightness = b; }
 };
 
-// Simple Blur (Box Blur 3x3)
+// Box blur, the average of the square of 2 * radius + 1 pixels around every pixel. This costs
+// the same for every radius (see Convolution.h).
 class BlurEffect : public PostProcessEffect
 {
+private:
+    Convolution convolution;
+    int radius;
 public:
-    BlurEffect(std::shared_ptr<IEffect> src) : PostProcessEffect(src) {}
+    BlurEffect(std::shared_ptr<IEffect> src, int r = 1) : PostProcessEffect(src), radius(r) {}
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    void SetRadius(int r) { radius = r; }
 };
 
 class FlashEffect : public IEffect
@@ -2,6 +2,7 @@
 #include "IEffect.h"
 #include <vector>
 #include "core/Particle.h"
+#include "core/AccumulationCanvas.h"
 
 namespace libled {
 
@@ -26,6 +27,10 @@ private:
     // Config
     Color baseColor;
     bool gravity;
+    bool accumulate;
+    
+    // Where the particles add up when accumulating
+    AccumulationCanvas light;
     
 public:
     ParticleSystemEffect();
@@ -34,6 +39,10 @@ public:
     
     void SetGravity(bool g) { gravity = g; }
     void SetBaseColor(Color c) { baseColor = c; }
+    
+    // When set, the particles add up as light (see AccumulationCanvas.h) instead of blending,
+    // so that they get brighter where they stack up
+    void SetAccumulate(bool a) { accumulate = a; }
 };
 
 class ExplosionEffect : public IEffect
@@ -1,6 +1,8 @@
 #pragma once
 #include "IEffect.h"
 #include "core/Color.h"
+#include "core/PlanarCanvas.h"
+#include <atomic>
 #include <functional>
 
 namespace libled {
@@ -16,8 +18,10 @@ public:
 
 private:
     ShaderFunction shader;
-    uint32_t startTime;
-    bool started;
+
+    // Time of the first frame, or -1 before it. Atomic, because the bands of a frame
+    // render at the same time (see IsBandSafe).
+    std::atomic<int64_t> startTime;
 
 public:
     /**
@@ -28,6 +32,61 @@ public:
 
     virtual void Reset() override;
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
+
+    // The shader function must be safe to call from multiple threads at the same time
+    virtual bool IsBandSafe() const override { return true; }
+};
+
+/**
+ * A row of pixels for a planar shader. The shader writes count values to each of the planes,
+ * of which value i is the pixel at normalized coordinates (u + i * du, v). The count is a
+ * multiple of PLANAR_VECTOR_WIDTH, so the shader can compute and store whole vectors; the
+ * values past the drawn pixels are ignored.
+ */
+struct ShaderRow
+{
+    float* r;
+    float* g;
+    float* b;
+    float* a;
+    float u;
+    float du;
+    float v;
+    int count;
+};
+
+/**
+ * PlanarShaderEffect - Like PixelShaderEffect, but the shader function shades a whole row at a
+ * time into the planes of a PlanarCanvas, with the channels as floats from 0 to 1. Shaders that
+ * compute the channels separately store them without building Colors, and the planes are
+ * interleaved into the canvas with SIMD at the end.
+ */
+class PlanarShaderEffect : public IEffect
+{
+public:
+    using RowShaderFunction = std::function<void(const ShaderRow& row, float time)>;
+
+private:
+    RowShaderFunction shader;
+
+    // Time of the first frame, or -1 before it. Atomic, because the bands of a frame
+    // render at the same time (see IsBandSafe).
+    std::atomic<int64_t> startTime;
+
+public:
+    /**
+     * Construct a PlanarShaderEffect with a custom row shader function.
+     * @param fn The shader function: void(const ShaderRow& row, float time)
+     */
+    PlanarShaderEffect(RowShaderFunction fn);
+
+    virtual void Reset() override;
+    virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
+
+    // The shader function must be safe to call from multiple threads at the same time
+    virtual bool IsBandSafe() const override { return true; }
 };
 
 }
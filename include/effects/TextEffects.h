@@ -128,7 +128,7 @@ private:
     
     TimePoint lastTime;
     TweenInt offset;
-    Canvas tempCanvas;
+    BitMask mask;
     Size targetSize;
     bool active;
     
@@ -2,6 +2,7 @@
 #include "IEffect.h"
 #include "core/Graphics.h"
 #include "core/Canvas.h"
+#include "core/CanvasView.h"
 #include <iostream>
 #include <vector>
 
@@ -37,17 +38,17 @@ public:
         }
 
         // Render A
-        canvasA.Clear(Color(0,0,0,0));
+        PrepareOffscreen(canvasA, canvas);
         if (sourceA) sourceA->Render(canvasA, timeMs);
         
         // Render B
-        canvasB.Clear(Color(0,0,0,0));
+        PrepareOffscreen(canvasB, canvas);
         if (sourceB) sourceB->Render(canvasB, timeMs);
         
         // Manual blend: interpolate between A and B based on progress
         // progress = 0 means show A, progress = 1 means show B
-        for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
-            for (int x = 0; x < DISPLAY_WIDTH; ++x) {
+        for (int y = 0; y < canvas.Height(); ++y) {
+            for (int x = 0; x < canvas.Width(); ++x) {
                 Color a = canvasA.GetPixel(x, y);
                 Color b = canvasB.GetPixel(x, y);
                 
@@ -76,6 +77,7 @@ public:
         : sourceA(a), sourceB(b), durationMs(duration) {}
         
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
 };
 
 class MeltTransitionEffect : public IEffect
@@ -106,8 +108,6 @@ class SlideTransitionEffect : public IEffect
     std::shared_ptr<IEffect> sourceB;
     int durationMs;
     TransitionDirection dir;
-    Canvas canvasA;
-    Canvas canvasB;
 public:
     SlideTransitionEffect(std::shared_ptr<IEffect> a, std::shared_ptr<IEffect> b, int duration, TransitionDirection d = TransitionDirection::Left)
         : sourceA(a), sourceB(b), durationMs(duration), dir(d) {}
@@ -120,12 +120,11 @@ class WipeTransitionEffect : public IEffect
     std::shared_ptr<IEffect> sourceB;
     int durationMs;
     TransitionDirection dir;
-    Canvas canvasA;
-    Canvas canvasB;
 public:
     WipeTransitionEffect(std::shared_ptr<IEffect> a, std::shared_ptr<IEffect> b, int duration, TransitionDirection d = TransitionDirection::Left)
         : sourceA(a), sourceB(b), durationMs(duration), dir(d) {}
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
+    virtual bool CoversFrame() const override { return true; }
 };
 
 class ZoomTransitionEffect : public IEffect
@@ -134,11 +133,12 @@ class ZoomTransitionEffect : public IEffect
     std::shared_ptr<IEffect> sourceB;
     int durationMs;
     bool zoomIn; // True = B zooms in, False = A zooms out
+    bool pixelated; // True = nearest sampling, False = bilinear (smooth) sampling
     Canvas canvasA;
     Canvas canvasB;
 public:
     ZoomTransitionEffect(std::shared_ptr<IEffect> a, std::shared_ptr<IEffect> b, int duration, bool pixelated = true)
-        : sourceA(a), sourceB(b), durationMs(duration), zoomIn(true) {}
+        : sourceA(a), sourceB(b), durationMs(duration), zoomIn(true), pixelated(pixelated) {}
     virtual void Render(Canvas& canvas, uint32_t timeMs) override;
 };
 
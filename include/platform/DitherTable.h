@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include "utils/Tools.h"
+
+// How a display with fewer levels than the canvas hides the steps between its levels
+enum class DitherMode : byte
+{
+	None,		// Values are rounded down to a level
+	Ordered,	// Values between two levels are spread over a fixed 4 x 4 pattern of pixels
+	Temporal	// Like Ordered, but the pattern moves every frame so that every pixel also
+				// averages to the value over the frames
+};
+
+/*
+  A dither table converts canvas values (0 to 255) to the values for a display that shows
+  fewer levels, like an LED panel with less than 8 PWM bits. The value of every pixel is
+  compared to a threshold from a 4 x 4 Bayer pattern, which decides whether it goes to the level
+  above or below. The results for all thresholds are looked up from a precomputed table, so
+  that the display can dither in the same loop that converts the pixels, at the cost of one
+  table lookup per channel.
+*/
+class DitherTable final
+{
+private:
+
+	// The display value for every canvas value, for every threshold (in order of the threshold)
+	std::array<std::array<byte, 256>, 16> outputs;
+
+	DitherMode mode;
+
+	// Frame counter for the temporal pattern
+	int frame;
+
+public:
+
+	DitherTable();
+
+	// Returns the mode by name ("none", "ordered" or "temporal"), or None when it is unknown
+	static DitherMode ParseMode(const String& name);
+
+	// Builds the table. targets[v] is the level (fractional, from 0 to levelcount - 1) which
+	// canvas value v should show and codes[l] is the display value that shows level l.
+	void Build(DitherMode mode, const float* targets, const byte* codes, int levelcount);
+
+	// Properties
+	inline DitherMode GetMode() const { return mode; }
+
+	// Returns true when the output changes every frame, also where the canvas did not change,
+	// so that the whole display must be updated every frame
+	inline bool ChangesEveryFrame() const { return mode == DitherMode::Temporal; }
+
+	// Returns the tables for the pixels on row y, of which pixel x uses row[x & 3]
+	void GetRow(int y, const byte* row[4]) const;
+
+	// Moves the temporal pattern to the next frame
+	inline void NextFrame() { frame = (frame + 1) & 15; }
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "platform/IGraphicsHAL.h"
+#include "platform/DitherTable.h"
 
 #ifdef RPI
 #include "utils/Configuration.h"
@@ -17,6 +18,19 @@ private:
 	// Brightness (0-100)
 	int brightness;
 
+	// Dithering to the levels of the PWM bits (see DitherTable), which then also does the
+	// luminance correction and brightness instead of the display
+	DitherTable dither;
+	int pwmbits;
+	bool luminancecorrect;
+
+	// Builds the dither table for the brightness
+	void BuildDither(DitherMode mode);
+
+	// Damage of the previous frame and the combined damage we update on the display canvas
+	Damage previousdamage;
+	Damage updatedamage;
+
 public:
 	DotMatrixGraphics(const Configuration& cfg);
 	virtual ~DotMatrixGraphics();
@@ -13,6 +13,8 @@ protected:
 public:
 
 	// Methods
+	// Present shows the canvas on the display. Only the damaged part of the canvas (see
+	// Canvas::GetDamage) has changed since the previous call, the rest may be skipped.
 	virtual void Present(Canvas& sourcecanvas) = 0;
 	virtual void SetBrightness(int b) = 0;
 	virtual int GetBrightness() const = 0;
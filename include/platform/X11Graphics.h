@@ -1,6 +1,7 @@
 #pragma once
 #include "platform/IGraphicsHAL.h"
 #include "utils/Configuration.h"
+#include "platform/DitherTable.h"
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xos.h>
@@ -23,6 +24,17 @@ private:
 	XImage* img;
 	char* imgdata;
 
+	// Set when the window must be redrawn completely
+	bool exposed;
+
+	// With less than 8 PWM bits, the window shows the levels the LED panel would show, with the
+	// same dithering (see DitherTable)
+	bool quantize;
+	DitherTable dither;
+
+	// Damage of the whole window, for dither patterns that change every frame
+	Damage alldamage;
+
 public:
 
 	X11Graphics(const Configuration& cfg);
@@ -68,6 +68,8 @@ public:
 	void DrawBlend(Canvas& canvas, Point pos, Color c) const;
 	void DrawAdd(Canvas& canvas, Point pos, Color c) const;
 	void DrawMask(Canvas& canvas, Point pos, Color c) const;
+	void Draw(Canvas& canvas, Point pos, Color c, BlendMode mode) const;
+	void Draw(BitMask& mask, Point pos, byte threshold = 0) const;
 	void DrawTexturedOpaque(Canvas& canvas, Point pos, const IImage& tex, Point texoffset = Point()) const;
 	void DrawTexturedMask(Canvas& canvas, Point pos, const IImage& tex, Point texoffset = Point()) const;
 	void DrawTexturedBlend(Canvas& canvas, Point pos, const IImage& tex, Point texoffset = Point()) const;
@@ -81,4 +83,5 @@ public:
 	void DrawShadowMask(Canvas& canvas, Point pos, int distance, Color c) const;
 	void DrawOutlineMask(Canvas& canvas, Point pos, int distance, Color c) const;
 	void DrawOutlineBlend(Canvas& canvas, Point pos, int distance, Color c) const;
+	void DrawOutline(BitMask& mask, Point pos, int distance, byte threshold = 0) const;
 };
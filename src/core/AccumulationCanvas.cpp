@@ -0,0 +1,126 @@
+#include <array>
+#include <cmath>
+#include "core/AccumulationCanvas.h"
+
+// Light up to 16 times white is tone-mapped by a table, above that Soft gives white
+static constexpr int SOFT_TABLE_SIZE = 4096;
+
+// Light up to the knee stays as it is with Soft
+static constexpr int SOFT_KNEE = 160;
+
+// Returns the table for ToneMapping::Soft. Above the knee, the light approaches white
+// exponentially, starting at the same slope as below the knee so that there is no visible edge.
+static const std::array<byte, SOFT_TABLE_SIZE>& SoftTable()
+{
+	static const std::array<byte, SOFT_TABLE_SIZE> table = []()
+	{
+		std::array<byte, SOFT_TABLE_SIZE> t;
+		const float range = static_cast<float>(255 - SOFT_KNEE);
+		for(int i = 0; i < SOFT_TABLE_SIZE; i++)
+		{
+			if(i <= SOFT_KNEE)
+				t[i] = static_cast<byte>(i);
+			else
+				t[i] = static_cast<byte>(std::lround(SOFT_KNEE + range * (1.0f - std::exp(-static_cast<float>(i - SOFT_KNEE) / range))));
+		}
+		return t;
+	}();
+	return table;
+}
+
+AccumulationCanvas::AccumulationCanvas() :
+	tonemapping(ToneMapping::Clamp)
+{
+	Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+AccumulationCanvas::AccumulationCanvas(int width, int height) :
+	tonemapping(ToneMapping::Clamp)
+{
+	Resize(width, height);
+}
+
+void AccumulationCanvas::Resize(int width, int height)
+{
+	REQUIRE((width >= 0) && (height >= 0));
+	this->width = width;
+	this->height = height;
+	pixels.assign(static_cast<size_t>(width) * height, LightColor { 0u, 0u, 0u });
+}
+
+void AccumulationCanvas::Clear(Color color)
+{
+	std::fill(pixels.begin(), pixels.end(), LightColor { color.r, color.g, color.b });
+}
+
+void AccumulationCanvas::DrawColorImageAdd(Point pos, const IImage& img)
+{
+	REQUIRE(img.HasColors());
+	int left = std::max(pos.x, 0);
+	int top = std::max(pos.y, 0);
+	int right = std::min(pos.x + img.Width(), width);
+	int bottom = std::min(pos.y + img.Height(), height);
+	ColorSampler sampler = img.GetColorSampler();
+	bool premultiplied = img.IsPremultiplied();
+	for(int y = top; y < bottom; y++)
+	{
+		const Color* src = sampler.Pointer(left - pos.x, y - pos.y);
+		LightColor* dst = &pixels[y * width];
+		for(int x = left; x < right; x++, src++)
+		{
+			Color c = *src;
+			if(!premultiplied)
+				c.Premultiply();
+			dst[x].r += c.r;
+			dst[x].g += c.g;
+			dst[x].b += c.b;
+		}
+	}
+}
+
+void AccumulationCanvas::DrawMonoImageAdd(Point pos, const IImage& img, Color color)
+{
+	REQUIRE(img.HasColors() == false);
+	int left = std::max(pos.x, 0);
+	int top = std::max(pos.y, 0);
+	int right = std::min(pos.x + img.Width(), width);
+	int bottom = std::min(pos.y + img.Height(), height);
+	MonoSampler sampler = img.GetMonoSampler();
+	color.Premultiply();
+	for(int y = top; y < bottom; y++)
+	{
+		const byte* coverage = sampler.Pointer(left - pos.x, y - pos.y);
+		LightColor* dst = &pixels[y * width];
+		for(int x = left; x < right; x++, coverage++)
+		{
+			uint cv = static_cast<uint>(*coverage);
+			dst[x].r += DIV_255_FAST(static_cast<uint>(color.r) * cv);
+			dst[x].g += DIV_255_FAST(static_cast<uint>(color.g) * cv);
+			dst[x].b += DIV_255_FAST(static_cast<uint>(color.b) * cv);
+		}
+	}
+}
+
+void AccumulationCanvas::ToneMap(Canvas& canvas, Point pos, ToneMapping mapping, BlendMode mode)
+{
+	tonemapping = mapping;
+	canvas.DrawRows(pos, *this, mode);
+}
+
+const Color* AccumulationCanvas::Row(int x, int y, int count, Color* scratch) const
+{
+	const LightColor* src = &pixels[y * width + x];
+	if(tonemapping == ToneMapping::Clamp)
+	{
+		for(int i = 0; i < count; i++)
+			scratch[i] = Color(static_cast<byte>(std::min(src[i].r, 255u)), static_cast<byte>(std::min(src[i].g, 255u)), static_cast<byte>(std::min(src[i].b, 255u)));
+	}
+	else
+	{
+		const std::array<byte, SOFT_TABLE_SIZE>& table = SoftTable();
+		const uint32_t last = static_cast<uint32_t>(SOFT_TABLE_SIZE - 1);
+		for(int i = 0; i < count; i++)
+			scratch[i] = Color(table[std::min(src[i].r, last)], table[std::min(src[i].g, last)], table[std::min(src[i].b, last)]);
+	}
+	return scratch;
+}
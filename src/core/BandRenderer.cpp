@@ -0,0 +1,115 @@
+#include "core/BandRenderer.h"
+
+BandRenderer::BandRenderer(int bands) :
+	generation(0),
+	pending(0),
+	stopthreads(false),
+	bands(bands),
+	renderers(nullptr),
+	renderercount(0),
+	viewcanvas(nullptr),
+	viewbuffer(nullptr)
+{
+	REQUIRE(bands >= 1);
+	for(int b = 1; b < bands; b++)
+	{
+		workers.push_back(std::thread(&BandRenderer::Thread, this, b));
+		pthread_setname_np(workers.back().native_handle(), "Band");
+	}
+}
+
+BandRenderer::~BandRenderer()
+{
+	// Shutdown worker threads
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopthreads = true;
+	}
+	startsignal.notify_all();
+	for(std::thread& t : workers)
+		t.join();
+}
+
+void BandRenderer::Render(Canvas& canvas, IRenderer* const* list, int count)
+{
+	// The views draw in the buffer of the canvas and recording is not thread-safe
+	REQUIRE(!canvas.IsView());
+	REQUIRE(!canvas.IsRecording());
+
+	MakeViews(canvas);
+	renderers = list;
+	renderercount = count;
+
+	// Start the workers and render the first band on this thread
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = bands - 1;
+		generation++;
+	}
+	startsignal.notify_all();
+	RenderBand(0);
+
+	// Wait for the other bands
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		donesignal.wait(lock, [this] { return pending == 0; });
+	}
+
+	for(std::unique_ptr<Canvas>& view : bandviews)
+		canvas.MergeDamage(*view);
+}
+
+void BandRenderer::MakeViews(Canvas& canvas)
+{
+	Rect area(0, 0, canvas.Width(), canvas.Height());
+	Rect clip = canvas.GetClip();
+	if((viewcanvas == &canvas) && (viewbuffer == canvas.GetBuffer()) &&
+	   (viewarea.width == area.width) && (viewarea.height == area.height) &&
+	   (viewclip.x == clip.x) && (viewclip.y == clip.y) && (viewclip.width == clip.width) && (viewclip.height == clip.height))
+		return;
+
+	// Make a view for each band. These collect their own damage, because
+	// the bands can't add their damage to the canvas at the same time.
+	bandviews.clear();
+	for(int b = 0; b < bands; b++)
+	{
+		int top = canvas.Height() * b / bands;
+		int bottom = canvas.Height() * (b + 1) / bands;
+		bandviews.emplace_back(new Canvas(canvas, area, true));
+		bandviews.back()->PushClip(Rect(0, top, canvas.Width(), bottom - top));
+	}
+	viewcanvas = &canvas;
+	viewbuffer = canvas.GetBuffer();
+	viewarea = area;
+	viewclip = clip;
+}
+
+void BandRenderer::RenderBand(int band)
+{
+	for(int i = 0; i < renderercount; i++)
+		renderers[i]->Render(*bandviews[band]);
+}
+
+// Worker thread
+void BandRenderer::Thread(int band)
+{
+	uint done = 0;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			startsignal.wait(lock, [this, done] { return stopthreads || (generation != done); });
+			if(stopthreads)
+				return;
+			done = generation;
+		}
+
+		RenderBand(band);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending--;
+		}
+		donesignal.notify_one();
+	}
+}
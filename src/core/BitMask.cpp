@@ -0,0 +1,228 @@
+#include <algorithm>
+#include "core/BitMask.h"
+
+BitMask::BitMask()
+{
+	Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+BitMask::BitMask(int width, int height)
+{
+	Resize(width, height);
+}
+
+void BitMask::Resize(int width, int height)
+{
+	REQUIRE((width >= 0) && (height >= 0));
+	this->width = width;
+	this->height = height;
+	rowwords = (width + 63) / 64;
+	words.assign(static_cast<size_t>(rowwords) * height, 0);
+}
+
+void BitMask::ClearPadding()
+{
+	if((width & 63) == 0)
+		return;
+	uint64_t keep = (1ull << (width & 63)) - 1;
+	for(int y = 0; y < height; y++)
+		GetRow(y)[rowwords - 1] &= keep;
+}
+
+void BitMask::Clear(bool value)
+{
+	std::fill(words.begin(), words.end(), value ? ~0ull : 0ull);
+	if(value)
+		ClearPadding();
+}
+
+void BitMask::SetRectangle(Rect r, bool value)
+{
+	int left = std::max(r.x, 0);
+	int top = std::max(r.y, 0);
+	int right = std::min(r.Right(), width - 1);
+	int bottom = std::min(r.Bottom(), height - 1);
+	if((left > right) || (top > bottom))
+		return;
+
+	int first = left >> 6;
+	int last = right >> 6;
+	uint64_t firstmask = ~0ull << (left & 63);
+	uint64_t lastmask = ~0ull >> (63 - (right & 63));
+	for(int y = top; y <= bottom; y++)
+	{
+		uint64_t* row = GetRow(y);
+		for(int i = first; i <= last; i++)
+		{
+			uint64_t m = ~0ull;
+			if(i == first)
+				m &= firstmask;
+			if(i == last)
+				m &= lastmask;
+			row[i] = value ? (row[i] | m) : (row[i] & ~m);
+		}
+	}
+}
+
+void BitMask::DrawImage(Point pos, const IImage& img, Rect imgrect, byte threshold)
+{
+	REQUIRE((imgrect.x >= 0) && (imgrect.y >= 0));
+	REQUIRE((imgrect.Right() < img.Width()) && (imgrect.Bottom() < img.Height()));
+	int left = std::max(pos.x, 0);
+	int top = std::max(pos.y, 0);
+	int right = std::min(pos.x + imgrect.width, width);
+	int bottom = std::min(pos.y + imgrect.height, height);
+	if(img.HasColors())
+	{
+		ColorSampler sampler = img.GetColorSampler();
+		for(int y = top; y < bottom; y++)
+		{
+			const Color* src = sampler.Pointer(imgrect.x + left - pos.x, imgrect.y + y - pos.y);
+			uint64_t* row = GetRow(y);
+			for(int x = left; x < right; x++, src++)
+			{
+				if(src->a > threshold)
+					row[x >> 6] |= 1ull << (x & 63);
+			}
+		}
+	}
+	else
+	{
+		MonoSampler sampler = img.GetMonoSampler();
+		for(int y = top; y < bottom; y++)
+		{
+			const byte* coverage = sampler.Pointer(imgrect.x + left - pos.x, imgrect.y + y - pos.y);
+			uint64_t* row = GetRow(y);
+			for(int x = left; x < right; x++, coverage++)
+			{
+				if(*coverage > threshold)
+					row[x >> 6] |= 1ull << (x & 63);
+			}
+		}
+	}
+}
+
+void BitMask::And(const BitMask& other)
+{
+	REQUIRE((other.width == width) && (other.height == height));
+	for(size_t i = 0; i < words.size(); i++)
+		words[i] &= other.words[i];
+}
+
+void BitMask::Or(const BitMask& other)
+{
+	REQUIRE((other.width == width) && (other.height == height));
+	for(size_t i = 0; i < words.size(); i++)
+		words[i] |= other.words[i];
+}
+
+void BitMask::Xor(const BitMask& other)
+{
+	REQUIRE((other.width == width) && (other.height == height));
+	for(size_t i = 0; i < words.size(); i++)
+		words[i] ^= other.words[i];
+}
+
+void BitMask::AndNot(const BitMask& other)
+{
+	REQUIRE((other.width == width) && (other.height == height));
+	for(size_t i = 0; i < words.size(); i++)
+		words[i] &= ~other.words[i];
+}
+
+void BitMask::Invert()
+{
+	for(uint64_t& w : words)
+		w = ~w;
+	ClearPadding();
+}
+
+void BitMask::Morph(bool grow)
+{
+	// Combine every pixel with its left and right neighbors, the shifts carry the bits over
+	// from the neighboring words
+	for(int y = 0; y < height; y++)
+	{
+		uint64_t* row = GetRow(y);
+		uint64_t prev = 0;
+		for(int i = 0; i < rowwords; i++)
+		{
+			uint64_t w = row[i];
+			uint64_t next = (i < (rowwords - 1)) ? row[i + 1] : 0;
+			uint64_t left = (w << 1) | (prev >> 63);
+			uint64_t right = (w >> 1) | (next << 63);
+			row[i] = grow ? (w | left | right) : (w & left & right);
+			prev = w;
+		}
+	}
+	if(grow)
+		ClearPadding();
+
+	// Then with the pixels above and below
+	scratch = words;
+	for(int y = 0; y < height; y++)
+	{
+		uint64_t* row = GetRow(y);
+		const uint64_t* center = &scratch[y * rowwords];
+		const uint64_t* above = (y > 0) ? center - rowwords : nullptr;
+		const uint64_t* below = (y < (height - 1)) ? center + rowwords : nullptr;
+		for(int i = 0; i < rowwords; i++)
+		{
+			uint64_t a = above ? above[i] : 0;
+			uint64_t b = below ? below[i] : 0;
+			row[i] = grow ? (center[i] | a | b) : (center[i] & a & b);
+		}
+	}
+}
+
+void BitMask::Dilate(int radius)
+{
+	for(int i = 0; i < radius; i++)
+		Morph(true);
+}
+
+void BitMask::Erode(int radius)
+{
+	for(int i = 0; i < radius; i++)
+		Morph(false);
+}
+
+int BitMask::Count() const
+{
+	int count = 0;
+	for(uint64_t w : words)
+		count += __builtin_popcountll(w);
+	return count;
+}
+
+bool BitMask::IsEmpty() const
+{
+	return std::all_of(words.begin(), words.end(), [](uint64_t w) { return w == 0; });
+}
+
+Rect BitMask::GetBounds() const
+{
+	int left = width;
+	int top = height;
+	int right = -1;
+	int bottom = -1;
+	for(int y = 0; y < height; y++)
+	{
+		const uint64_t* row = GetRow(y);
+		int first = 0;
+		while((first < rowwords) && (row[first] == 0))
+			first++;
+		if(first == rowwords)
+			continue;
+		int last = rowwords - 1;
+		while(row[last] == 0)
+			last--;
+		left = std::min(left, (first << 6) + __builtin_ctzll(row[first]));
+		right = std::max(right, (last << 6) + 63 - __builtin_clzll(row[last]));
+		top = std::min(top, y);
+		bottom = y;
+	}
+	if(right < 0)
+		return Rect();
+	return Rect(left, top, right - left + 1, bottom - top + 1);
+}
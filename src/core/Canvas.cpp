@@ -1,119 +1,644 @@
+#include <numeric>
 #include "core/Canvas.h"
+#include "core/Blitter.h"
 #include "external/lodepng.h"
 #include "utils/File.h"
 
-Canvas::Canvas()
+// Copies a row of pixels, converting them when only one side has premultiplied alpha
+static void CopyPixels(Color* dst, bool dstpremultiplied, const Color* src, bool srcpremultiplied, int count)
 {
-    Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	if(dstpremultiplied == srcpremultiplied)
+		memcpy(dst, src, count * sizeof(Color));
+	else if(dstpremultiplied)
+		PremultiplySpan(dst, src, count);
+	else
+		UnpremultiplySpan(dst, src, count);
+}
+
+// Returns the operation which draws a color image with the mode
+static DrawOp ColorImageOp(BlendMode mode)
+{
+	switch(mode)
+	{
+		case BlendMode::Opaque: return DrawOp::ColorImage;
+		case BlendMode::Blend: return DrawOp::ColorImageBlend;
+		case BlendMode::Add: return DrawOp::ColorImageAdd;
+		case BlendMode::Mask: return DrawOp::ColorImageMask;
+		default: return DrawOp::ColorImageMode;
+	}
+}
+
+// Returns the operation which draws a monochrome image with the mode
+static DrawOp MonoImageOp(BlendMode mode)
+{
+	switch(mode)
+	{
+		case BlendMode::Opaque: return DrawOp::MonoImage;
+		case BlendMode::Blend: return DrawOp::MonoImageBlend;
+		case BlendMode::Add: return DrawOp::MonoImageAdd;
+		case BlendMode::Mask: return DrawOp::MonoImageMask;
+		default: return DrawOp::MonoImageMode;
+	}
+}
+
+Canvas::Canvas() :
+	pixels(nullptr),
+	width(0),
+	height(0),
+	stride(0),
+	owner(this),
+	trackdamage(false),
+	cleared(false),
+	premultiplied(false),
+	recording(nullptr),
+	damageowner(this)
+{
+	Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+Canvas::Canvas(int w, int h) :
+	pixels(nullptr),
+	width(0),
+	height(0),
+	stride(0),
+	owner(this),
+	trackdamage(false),
+	cleared(false),
+	premultiplied(false),
+	recording(nullptr),
+	damageowner(this)
+{
+	Resize(w, h);
+}
+
+Canvas::Canvas(const Canvas& other) :
+	Canvas(other.width, other.height)
+{
+	premultiplied = other.IsPremultiplied();
+	other.CopyTo(*this);
+}
+
+Canvas::Canvas(Canvas& parent, Rect area, bool owndamage) :
+	pixels(parent.pixels + area.y * parent.stride + area.x),
+	width(area.width),
+	height(area.height),
+	stride(parent.stride),
+	owner(parent.owner),
+	ownerpos(parent.ownerpos.x + area.x, parent.ownerpos.y + area.y),
+	trackdamage(false),
+	cleared(false),
+	premultiplied(false),
+	recording(nullptr),
+	damageowner(owndamage ? this : parent.damageowner)
+{
+	REQUIRE((area.width >= 0) && (area.height >= 0));
+
+	// We only have pixels where the view overlaps the parent
+	// and we can only draw where the parent can draw
+	boundsleft = std::max(parent.boundsleft - area.x, 0);
+	boundstop = std::max(parent.boundstop - area.y, 0);
+	boundsright = std::min(parent.boundsright - area.x, width - 1);
+	boundsbottom = std::min(parent.boundsbottom - area.y, height - 1);
+	clipleft = std::max(parent.clipleft - area.x, 0);
+	cliptop = std::max(parent.cliptop - area.y, 0);
+	clipright = std::min(parent.clipright - area.x, width - 1);
+	clipbottom = std::min(parent.clipbottom - area.y, height - 1);
+
+	// Damage is in the coordinates of the owner
+	if(owndamage)
+	{
+		damage.Resize(owner->width, owner->height);
+		drawn.Resize(owner->width, owner->height);
+	}
 }
 
 Canvas::~Canvas()
 {
 }
 
-void Canvas::Resize(int width, int height)
+Canvas& Canvas::operator=(const Canvas& other)
+{
+	if(this != &other)
+	{
+		if(!IsView())
+			SetPremultiplied(other.IsPremultiplied());
+		other.CopyTo(*this);
+	}
+	return *this;
+}
+
+void Canvas::Resize(int w, int h)
+{
+	REQUIRE((w >= 0) && (h >= 0));
+	REQUIRE(!IsView());
+	width = w;
+	height = h;
+	stride = w;
+	renderbuffer.resize(w * h);
+	pixels = renderbuffer.data();
+	boundsleft = 0;
+	boundstop = 0;
+	boundsright = w - 1;
+	boundsbottom = h - 1;
+	clipleft = 0;
+	cliptop = 0;
+	clipright = w - 1;
+	clipbottom = h - 1;
+	clipstack.clear();
+
+	// The contents are undefined now
+	damage.Resize(w, h);
+	damage.AddAll();
+	drawn.Resize(w, h);
+	drawn.AddAll();
+	cleared = false;
+}
+
+void Canvas::TrackDamage(bool enable)
+{
+	// We don't know what was drawn while not tracking
+	owner->trackdamage = enable;
+	owner->damage.AddAll();
+	owner->drawn.AddAll();
+	owner->cleared = false;
+}
+
+void Canvas::MergeDamage(Canvas& view)
 {
-    renderbuffer.resize(width * height);
+	REQUIRE(view.owner == this);
+	if(trackdamage)
+	{
+		damage.Add(view.damage);
+		drawn.Add(view.drawn);
+	}
+	view.damage.Clear();
+	view.drawn.Clear();
+}
+
+void Canvas::SetPremultiplied(bool enable)
+{
+	REQUIRE(!IsView());
+	if(enable == premultiplied)
+		return;
+
+	for(int y = 0; y < height; y++)
+	{
+		if(enable)
+			PremultiplySpan(&pixels[y * stride], &pixels[y * stride], width);
+		else
+			UnpremultiplySpan(&pixels[y * stride], &pixels[y * stride], width);
+	}
+	premultiplied = enable;
+
+	// Translucent pixels have changed, including the clear color
+	damage.AddAll();
+	drawn.AddAll();
+	cleared = false;
+}
+
+void Canvas::PushClip(Rect r)
+{
+	clipstack.push_back(GetClip());
+	clipleft = std::max(clipleft, r.x);
+	cliptop = std::max(cliptop, r.y);
+	clipright = std::min(clipright, r.Right());
+	clipbottom = std::min(clipbottom, r.Bottom());
+}
+
+void Canvas::PopClip()
+{
+	REQUIRE(!clipstack.empty());
+	Rect r = clipstack.back();
+	clipstack.pop_back();
+	clipleft = r.x;
+	cliptop = r.y;
+	clipright = r.Right();
+	clipbottom = r.Bottom();
+}
+
+Rect Canvas::GetClip() const
+{
+	return Rect(clipleft, cliptop, clipright - clipleft + 1, clipbottom - cliptop + 1);
 }
 
 void Canvas::Clear(Color color)
 {
-	std::fill(renderbuffer.begin(), renderbuffer.end(), color);
+	if(owner->recording)
+	{
+		DrawCommand command;
+		command.op = DrawOp::Clear;
+		command.color = color;
+		Record(command);
+		return;
+	}
+
+	color = CanvasColor(color);
+
+	if(IsView() || !IsClipFull())
+	{
+		// Clear only the area we can draw in
+		if(IsClipEmpty())
+			return;
+		for(int y = cliptop; y <= clipbottom; y++)
+			std::fill_n(&pixels[y * stride + clipleft], clipright - clipleft + 1, color);
+		AddDamage(clipleft, cliptop, clipright, clipbottom);
+		return;
+	}
+
+	if(trackdamage && cleared && (color == clearcolor))
+	{
+		// Only what was drawn since the previous clear needs clearing
+		for(int y = drawn.Top(); y <= drawn.Bottom(); y++)
+		{
+			if(drawn.IsRowDamaged(y))
+				std::fill_n(&pixels[y * stride + drawn.RowLeft(y)], drawn.RowRight(y) - drawn.RowLeft(y) + 1, color);
+		}
+		damage.Add(drawn);
+	}
+	else
+	{
+		std::fill(renderbuffer.begin(), renderbuffer.end(), color);
+		damage.AddAll();
+	}
+
+	drawn.Clear();
+	cleared = trackdamage;
+	clearcolor = color;
+}
+
+uint32_t Canvas::HashRow(int y) const
+{
+	// A view may lie partially outside its parent, only the pixels in its bounds exist
+	REQUIRE((y >= 0) && (y < height));
+	if((y < boundstop) || (y > boundsbottom) || (boundsleft > boundsright))
+		return HashSpan(nullptr, 0);
+	return HashSpan(&pixels[y * stride + boundsleft], boundsright - boundsleft + 1);
+}
+
+void Canvas::HashRows(std::vector<uint32_t>& hashes) const
+{
+	hashes.resize(height);
+	for(int y = 0; y < height; y++)
+		hashes[y] = HashRow(y);
+}
+
+bool Canvas::DiffRows(std::vector<uint32_t>& hashes, Damage& changed) const
+{
+	if((changed.Width() != width) || (changed.Height() != height))
+		changed.Resize(width, height);
+	else
+		changed.Clear();
+
+	bool all = (hashes.size() != static_cast<size_t>(height));
+	if(all)
+		hashes.resize(height);
+	for(int y = 0; y < height; y++)
+	{
+		uint32_t hash = HashRow(y);
+		if(all || (hash != hashes[y]))
+		{
+			hashes[y] = hash;
+			if(width > 0)
+				changed.AddRect(0, y, width - 1, y);
+		}
+	}
+	return !changed.IsEmpty();
+}
+
+void Canvas::CopyTo(Canvas& canvas) const
+{
+	if((canvas.width != width) || (canvas.height != height))
+		canvas.Resize(width, height);
+
+	if(!IsView() && canvas.IsClipFull() && (canvas.stride == width) && (canvas.IsPremultiplied() == IsPremultiplied()))
+	{
+		memcpy(canvas.pixels, pixels, width * height * sizeof(Color));
+		canvas.AddDamage(0, 0, width - 1, height - 1);
+	}
+	else
+	{
+		// Copy only the area that we have and the other canvas can draw in
+		int left = std::max(boundsleft, canvas.clipleft);
+		int top = std::max(boundstop, canvas.cliptop);
+		int right = std::min(boundsright, canvas.clipright);
+		int bottom = std::min(boundsbottom, canvas.clipbottom);
+		if((left > right) || (top > bottom))
+			return;
+		for(int y = top; y <= bottom; y++)
+			CopyPixels(&canvas.pixels[y * canvas.stride + left], canvas.IsPremultiplied(), &pixels[y * stride + left], IsPremultiplied(), right - left + 1);
+		canvas.AddDamage(left, top, right, bottom);
+	}
 }
 
-void Canvas::DrawRectangle(Point p1, Point p2, Color linecolor, Color fillcolor)
+void Canvas::DrawRectangle(Point p1, Point p2, Color linecolor, Color fillcolor, BlendMode mode)
 {
+	if(owner->recording)
+	{
+		DrawCommand command;
+		command.op = DrawOp::Rectangle;
+		command.color = linecolor;
+		command.fillcolor = fillcolor;
+		command.pos = p1;
+		command.pos2 = p2;
+		command.mode = mode;
+		Record(command);
+		return;
+	}
+
 	// Make sure that p1 is at the left-top (lowest coordinates)
 	// and p2 at the right-bottom (highest coordinates)
 	if(p1.x > p2.x) std::swap(p1.x, p2.x);
 	if(p1.y > p2.y) std::swap(p1.y, p2.y);
 
 	// Completely outside view?
-	if((p1.x >= DISPLAY_WIDTH) || (p1.y >= DISPLAY_HEIGHT) || (p2.x < 0) || (p2.y < 0))
+	if(!IsInClip(p1, p2))
 		return;
 
-	Point cp1 = p1.Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
-	Point cp2 = p2.Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	// Draw with the span kernel for the way the pixels are stored
+	ColorSpanFunction span = GetColorSpan(mode);
+	linecolor = CanvasColor(linecolor);
+	fillcolor = CanvasColor(fillcolor);
 
-	// Draw the border lines
-	if((p1.x >= 0) && (p1.x < DISPLAY_WIDTH))
+	Point cp1 = ClipPoint(p1);
+	Point cp2 = ClipPoint(p2);
+	AddDamage(cp1.x, cp1.y, cp2.x, cp2.y);
+
+	// Draw the border lines. Every pixel is drawn once, because blending twice would
+	// make the corners (or a rectangle of one pixel wide or high) stand out.
+	if((p1.y >= cliptop) && (p1.y <= clipbottom))
 	{
-		for(int y = cp1.y; y <= cp2.y; y++)
-			renderbuffer[y * DISPLAY_WIDTH + p1.x] = linecolor;
+		span(&pixels[p1.y * stride + cp1.x], linecolor, cp2.x - cp1.x + 1);
 	}
-	if((p2.x >= 0) && (p2.x < DISPLAY_WIDTH))
+	if((p2.y != p1.y) && (p2.y >= cliptop) && (p2.y <= clipbottom))
 	{
-		for(int y = cp1.y; y <= cp2.y; y++)
-			renderbuffer[y * DISPLAY_WIDTH + p2.x] = linecolor;
+		span(&pixels[p2.y * stride + cp1.x], linecolor, cp2.x - cp1.x + 1);
 	}
-	if((p1.y >= 0) && (p1.y < DISPLAY_HEIGHT))
+	int sidetop = std::max(p1.y + 1, cliptop);
+	int sidebottom = std::min(p2.y - 1, clipbottom);
+	if((p1.x >= clipleft) && (p1.x <= clipright))
 	{
-		for(int x = cp1.x; x <= cp2.x; x++)
-			renderbuffer[p1.y * DISPLAY_WIDTH + x] = linecolor;
+		for(int y = sidetop; y <= sidebottom; y++)
+			span(&pixels[y * stride + p1.x], linecolor, 1);
 	}
-	if((p2.y >= 0) && (p2.y < DISPLAY_HEIGHT))
+	if((p2.x != p1.x) && (p2.x >= clipleft) && (p2.x <= clipright))
 	{
-		for(int x = cp1.x; x <= cp2.x; x++)
-			renderbuffer[p2.y * DISPLAY_WIDTH + x] = linecolor;
+		for(int y = sidetop; y <= sidebottom; y++)
+			span(&pixels[y * stride + p2.x], linecolor, 1);
 	}
 
 	// Shrink by 1 pixel on each side and fill this area
-	cp1 = p1.Offset(1, 1).Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
-	cp2 = p2.Offset(-1, -1).Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	// (the area may be entirely outside the view even when the border is not)
+	cp1 = p1.Offset(1, 1);
+	cp2 = p2.Offset(-1, -1);
+	if(!IsInClip(cp1, cp2))
+		return;
+	cp1 = ClipPoint(cp1);
+	cp2 = ClipPoint(cp2);
 	for(int y = cp1.y; y <= cp2.y; y++)
+		span(&pixels[y * stride + cp1.x], fillcolor, cp2.x - cp1.x + 1);
+}
+
+ColorSpanFunction Canvas::GetColorSpan(BlendMode mode) const
+{
+	switch(mode)
 	{
-		for(int x = cp1.x; x <= cp2.x; x++)
-			renderbuffer[y * DISPLAY_WIDTH + x] = fillcolor;
+		case BlendMode::Opaque: return FillSpan;
+		case BlendMode::Blend: return IsPremultiplied() ? static_cast<ColorSpanFunction>(BlendPremultipliedSpan) : static_cast<ColorSpanFunction>(BlendSpan);
+		case BlendMode::Add: return IsPremultiplied() ? static_cast<ColorSpanFunction>(AddPremultipliedSpan) : static_cast<ColorSpanFunction>(AddSpan);
+		case BlendMode::Mask: return static_cast<ColorSpanFunction>(MaskSpan);
+		case BlendMode::Multiply: return IsPremultiplied() ? static_cast<ColorSpanFunction>(MultiplyPremultipliedSpan) : static_cast<ColorSpanFunction>(MultiplySpan);
+		case BlendMode::Screen: return IsPremultiplied() ? static_cast<ColorSpanFunction>(ScreenPremultipliedSpan) : static_cast<ColorSpanFunction>(ScreenSpan);
+		case BlendMode::Overlay: return IsPremultiplied() ? static_cast<ColorSpanFunction>(OverlayPremultipliedSpan) : static_cast<ColorSpanFunction>(OverlaySpan);
+		case BlendMode::Darken: return IsPremultiplied() ? static_cast<ColorSpanFunction>(DarkenPremultipliedSpan) : static_cast<ColorSpanFunction>(DarkenSpan);
+		case BlendMode::Lighten: return IsPremultiplied() ? static_cast<ColorSpanFunction>(LightenPremultipliedSpan) : static_cast<ColorSpanFunction>(LightenSpan);
+		case BlendMode::Difference: return IsPremultiplied() ? static_cast<ColorSpanFunction>(DifferencePremultipliedSpan) : static_cast<ColorSpanFunction>(DifferenceSpan);
+		default: NOT_SUPPORTED; return FillSpan;
 	}
 }
 
-void Canvas::DrawRectangleBlend(Point p1, Point p2, Color linecolor, Color fillcolor)
+void Canvas::FillPolygon(const Point* points, int count, Color color, BlendMode mode)
 {
-	// Make sure that p1 is at the left-top (lowest coordinates)
-	// and p2 at the right-bottom (highest coordinates)
-	if(p1.x > p2.x) std::swap(p1.x, p2.x);
-	if(p1.y > p2.y) std::swap(p1.y, p2.y);
+	if(count < 3)
+		return;
 
-	// Completely outside view?
-	if((p1.x >= DISPLAY_WIDTH) || (p1.y >= DISPLAY_HEIGHT) || (p2.x < 0) || (p2.y < 0))
+	// Bounding box of the polygon
+	int left = points[0].x, top = points[0].y, right = points[0].x, bottom = points[0].y;
+	for(int i = 1; i < count; i++)
+	{
+		left = std::min(left, points[i].x);
+		top = std::min(top, points[i].y);
+		right = std::max(right, points[i].x);
+		bottom = std::max(bottom, points[i].y);
+	}
+
+	if(owner->recording)
+	{
+		DrawCommand command;
+		command.op = DrawOp::FillPolygon;
+		command.color = color;
+		command.mode = mode;
+		command.pos = Point(left, top);
+		command.pos2 = Point(right, bottom);
+		command.points.assign(points, points + count);
+		Record(command);
 		return;
+	}
 
-	Point cp1 = p1.Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
-	Point cp2 = p2.Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	// Completely outside view? The bottom row is never filled.
+	if(!IsInClip(Point(left, top), Point(right, bottom - 1)))
+		return;
 
-	// Draw the border lines
-	if((p1.x >= 0) && (p1.x < DISPLAY_WIDTH))
+	// The edge table holds the edges sorted by their top row. Horizontal edges are left out,
+	// the edges next to them end or start on that row. An edge covers the rows from its top
+	// up to (but not including) its bottom. Its x on a row is kept as an exact fraction
+	// x + num / den, which steps to the next row without rounding errors.
+	struct Edge
+	{
+		int top;
+		int bottom;
+		int x;
+		int num;
+		int den;
+		int stepx;
+		int stepnum;
+	};
+	vector<Edge> edges;
+	edges.reserve(count);
+	for(int i = 0; i < count; i++)
 	{
-		for(int y = cp1.y; y <= cp2.y; y++)
-			renderbuffer[y * DISPLAY_WIDTH + p1.x].Blend(linecolor);
+		Point a = points[i];
+		Point b = points[(i + 1) % count];
+		if(a.y == b.y)
+			continue;
+		if(a.y > b.y)
+			std::swap(a, b);
+
+		// The step per row, split into a whole part and a remaining fraction
+		Edge e;
+		e.top = a.y;
+		e.bottom = b.y;
+		e.den = b.y - a.y;
+		int dx = b.x - a.x;
+		e.stepx = (dx >= 0) ? (dx / e.den) : -((-dx + e.den - 1) / e.den);
+		e.stepnum = dx - e.stepx * e.den;
+		e.x = a.x;
+		e.num = 0;
+		edges.push_back(e);
 	}
-	if((p2.x >= 0) && (p2.x < DISPLAY_WIDTH))
+	std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.top < b.top; });
+
+	ColorSpanFunction span = GetColorSpan(mode);
+	color = CanvasColor(color);
+
+	// Walk the rows with the active edges. A pixel is inside when its center is at or to the
+	// right of an edge x, so every edge starts or ends its span at the first pixel x >= edge x.
+	vector<Edge> active;
+	vector<int> crossings;
+	size_t next = 0;
+	int lasty = std::min(bottom - 1, clipbottom);
+	for(int y = std::max(top, cliptop); y <= lasty; y++)
 	{
-		for(int y = cp1.y; y <= cp2.y; y++)
-			renderbuffer[y * DISPLAY_WIDTH + p2.x].Blend(linecolor);
+		// Remove the edges that ended and add the edges that start here. Edges that start above
+		// the clip rectangle are moved to the first row at once.
+		active.erase(std::remove_if(active.begin(), active.end(), [y](const Edge& e) { return e.bottom <= y; }), active.end());
+		while((next < edges.size()) && (edges[next].top <= y))
+		{
+			Edge e = edges[next++];
+			if(e.bottom <= y)
+				continue;
+			if(e.top < y)
+			{
+				int64_t skip = static_cast<int64_t>(y - e.top) * (e.stepx * e.den + e.stepnum);
+				int64_t whole = (skip >= 0) ? (skip / e.den) : -((-skip + e.den - 1) / e.den);
+				e.x += static_cast<int>(whole);
+				e.num = static_cast<int>(skip - whole * e.den);
+			}
+			active.push_back(e);
+		}
+
+		// Sort the crossings and fill between the pairs (the even-odd rule)
+		crossings.clear();
+		for(const Edge& e : active)
+			crossings.push_back(e.x + ((e.num > 0) ? 1 : 0));
+		std::sort(crossings.begin(), crossings.end());
+		for(size_t i = 0; i + 1 < crossings.size(); i += 2)
+			FillRow(y, crossings[i], crossings[i + 1] - 1, color, span);
+
+		// Step the edges to the next row
+		for(Edge& e : active)
+		{
+			e.x += e.stepx;
+			e.num += e.stepnum;
+			if(e.num >= e.den)
+			{
+				e.num -= e.den;
+				e.x++;
+			}
+		}
 	}
-	if((p1.y >= 0) && (p1.y < DISPLAY_HEIGHT))
+}
+
+// Determines the half widths of the rows of a filled ellipse, from the center row (index 0)
+// to the top row (index ry). A pixel is inside when its center lies inside the ellipse with the
+// radii extended by half a pixel, which gives the same round shapes as the midpoint circle
+// algorithm. The width only shrinks going up, so the rows are found with a single walk.
+static void EllipseHalfWidths(int rx, int ry, vector<int>& halfwidths)
+{
+	halfwidths.resize(ry + 1);
+	int64_t a2 = static_cast<int64_t>(2 * rx + 1) * (2 * rx + 1);
+	int64_t b2 = static_cast<int64_t>(2 * ry + 1) * (2 * ry + 1);
+	int64_t limit = a2 * b2;
+	int dx = rx;
+	for(int dy = 0; dy <= ry; dy++)
 	{
-		for(int x = cp1.x; x <= cp2.x; x++)
-			renderbuffer[p1.y * DISPLAY_WIDTH + x].Blend(linecolor);
+		int64_t yterm = static_cast<int64_t>(4) * dy * dy * a2;
+		while((dx > 0) && (static_cast<int64_t>(4) * dx * dx * b2 + yterm > limit))
+			dx--;
+		halfwidths[dy] = dx;
 	}
-	if((p2.y >= 0) && (p2.y < DISPLAY_HEIGHT))
+}
+
+void Canvas::FillEllipse(Point center, int rx, int ry, Color color, BlendMode mode)
+{
+	if((rx < 0) || (ry < 0))
+		return;
+
+	Point p1 = center.Offset(-rx, -ry);
+	Point p2 = center.Offset(rx, ry);
+	if(owner->recording)
 	{
-		for(int x = cp1.x; x <= cp2.x; x++)
-			renderbuffer[p2.y * DISPLAY_WIDTH + x].Blend(linecolor);
+		DrawCommand command;
+		command.op = DrawOp::FillEllipse;
+		command.color = color;
+		command.mode = mode;
+		command.pos = p1;
+		command.pos2 = p2;
+		Record(command);
+		return;
 	}
 
-	// Shrink by 1 pixel on each side and fill this area
-	cp1 = p1.Offset(1, 1).Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
-	cp2 = p2.Offset(-1, -1).Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
-	for(int y = cp1.y; y <= cp2.y; y++)
+	// Completely outside view?
+	if(!IsInClip(p1, p2))
+		return;
+
+	ColorSpanFunction span = GetColorSpan(mode);
+	color = CanvasColor(color);
+
+	vector<int> halfwidths;
+	EllipseHalfWidths(rx, ry, halfwidths);
+	FillRow(center.y, center.x - halfwidths[0], center.x + halfwidths[0], color, span);
+	for(int dy = 1; dy <= ry; dy++)
+	{
+		int hw = halfwidths[dy];
+		FillRow(center.y - dy, center.x - hw, center.x + hw, color, span);
+		FillRow(center.y + dy, center.x - hw, center.x + hw, color, span);
+	}
+}
+
+void Canvas::FillRoundedRectangle(Point p1, Point p2, int radius, Color color, BlendMode mode)
+{
+	// Make sure that p1 is at the left-top (lowest coordinates)
+	// and p2 at the right-bottom (highest coordinates)
+	if(p1.x > p2.x) std::swap(p1.x, p2.x);
+	if(p1.y > p2.y) std::swap(p1.y, p2.y);
+
+	// The corners can't be rounder than fits the rectangle
+	radius = std::clamp(radius, 0, std::min(p2.x - p1.x, p2.y - p1.y) / 2);
+
+	if(owner->recording)
 	{
-		for(int x = cp1.x; x <= cp2.x; x++)
-			renderbuffer[y * DISPLAY_WIDTH + x].Blend(fillcolor);
+		DrawCommand command;
+		command.op = DrawOp::FillRoundedRectangle;
+		command.color = color;
+		command.mode = mode;
+		command.pos = p1;
+		command.pos2 = p2;
+		command.radius = radius;
+		Record(command);
+		return;
+	}
+
+	// Completely outside view?
+	if(!IsInClip(p1, p2))
+		return;
+
+	ColorSpanFunction span = GetColorSpan(mode);
+	color = CanvasColor(color);
+
+	// The corners are quarters of a circle with its center inset by the radius
+	vector<int> halfwidths;
+	EllipseHalfWidths(radius, radius, halfwidths);
+	int top = std::max(p1.y, cliptop);
+	int bottom = std::min(p2.y, clipbottom);
+	for(int y = top; y <= bottom; y++)
+	{
+		int dy = std::max(std::max(p1.y + radius - y, y - (p2.y - radius)), 0);
+		int inset = radius - halfwidths[dy];
+		FillRow(y, p1.x + inset, p2.x - inset, color, span);
 	}
 }
 
-bool Canvas::PrepareImageDraw(Point pos, const IImage& img, Rect& imgrect, Rect& drawrect)
+bool Canvas::PrepareImageDraw(Point pos, Size imgsize, Rect& imgrect, Rect& drawrect)
 {
 	if((imgrect.width <= 0) || (imgrect.height <= 0))
 		return false;
@@ -121,443 +646,720 @@ bool Canvas::PrepareImageDraw(Point pos, const IImage& img, Rect& imgrect, Rect&
 	// Image rectangle valid?
 	REQUIRE(imgrect.x >= 0);
 	REQUIRE(imgrect.y >= 0);
-	REQUIRE(imgrect.x < img.Width());
-	REQUIRE(imgrect.y < img.Height());
-	REQUIRE(imgrect.Right() < img.Width());
-	REQUIRE(imgrect.Bottom() < img.Height());
+	REQUIRE(imgrect.x < imgsize.width);
+	REQUIRE(imgrect.y < imgsize.height);
+	REQUIRE(imgrect.Right() < imgsize.width);
+	REQUIRE(imgrect.Bottom() < imgsize.height);
 
 	// Determine right-bottom pixel on target
 	Point lastpos = pos.Offset(imgrect.GetSize()).Offset(-1, -1);
 
 	// Completely outside view?
-	if((pos.x >= DISPLAY_WIDTH) || (pos.y >= DISPLAY_HEIGHT) || (lastpos.x < 0) || (lastpos.y < 0))
+	if(!IsInClip(pos, lastpos))
 		return false;
 
 	// Determine clipped target area and image area
-	Point drawlefttop = pos.Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	Point drawlefttop = ClipPoint(pos);
 	imgrect.x += drawlefttop.x - pos.x;
 	imgrect.y += drawlefttop.y - pos.y;
-	Point drawrightbottom = lastpos.Clip(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	Point drawrightbottom = ClipPoint(lastpos);
 	drawrect = Rect(drawlefttop, Size(drawrightbottom.x - drawlefttop.x, drawrightbottom.y - drawlefttop.y));
 
 	// OK to draw this image
 	return true;
 }
 
-void Canvas::DrawColorImage(Point pos, const IImage& img, Rect imgrect)
+template<typename Op, typename Source, typename Modulation>
+void Canvas::Blit(Size imgsize, const BlitItem* items, int count, Source source, const Modulation& modulation)
 {
-	REQUIRE(img.HasColors());
+	Color scratch[BLIT_CHUNK_SIZE];
+	for(int i = 0; i < count; i++)
+	{
+		Rect imgrect = items[i].imgrect;
+		Rect drawrect;
+		if(!PrepareImageDraw(items[i].pos, imgsize, imgrect, drawrect))
+			continue;
 
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
+		source.Prepare(items[i].imgrect);
+		AddDamage(drawrect.x, drawrect.y, drawrect.x + drawrect.width, drawrect.y + drawrect.height);
 
-	// Draw image
-	ColorSampler sampler = img.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
-	{
-		for(int x = 0; x <= drawrect.width; x++)
-			SetPixel(drawrect.x + x, drawrect.y + y, sampler(imgrect.x + x, imgrect.y + y));
+		for(int y = 0; y <= drawrect.height; y++)
+		{
+			Color* dst = &pixels[(drawrect.y + y) * stride + drawrect.x];
+			for(int x = 0; x <= drawrect.width; x += BLIT_CHUNK_SIZE)
+			{
+				int chunk = std::min(BLIT_CHUNK_SIZE, drawrect.width + 1 - x);
+				const Color* row = source.Row(imgrect.x + x, imgrect.y + y, chunk, scratch);
+				row = modulation.Apply(row, chunk, scratch);
+				Op::Apply(dst + x, row, chunk);
+			}
+		}
 	}
 }
 
-void Canvas::DrawColorImageBlend(Point pos, const IImage& img, Rect imgrect)
+template<typename StraightOp, typename PremultipliedOp, typename Source, typename Modulation>
+void Canvas::BlitColors(Size imgsize, const BlitItem* items, int count, Source source, bool sourcepremultiplied, const Modulation& modulation)
 {
-	REQUIRE(img.HasColors());
-
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
-
-	// Draw image
-	ColorSampler sampler = img.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	if(IsPremultiplied())
+	{
+		if(sourcepremultiplied)
+			Blit<PremultipliedOp>(imgsize, items, count, source, modulation);
+		else
+			Blit<PremultipliedOp>(imgsize, items, count, source, ChainedModulation<PremultiplyModulation, Modulation>(PremultiplyModulation(), modulation));
+	}
+	else
 	{
-		for(int x = 0; x <= drawrect.width; x++)
-			BlendPixel(drawrect.x + x, drawrect.y + y, sampler(imgrect.x + x, imgrect.y + y));
+		if(sourcepremultiplied)
+			Blit<StraightOp>(imgsize, items, count, source, ChainedModulation<UnpremultiplyModulation, Modulation>(UnpremultiplyModulation(), modulation));
+		else
+			Blit<StraightOp>(imgsize, items, count, source, modulation);
 	}
 }
 
-void Canvas::DrawColorImageAdd(Point pos, const IImage& img, Rect imgrect)
+template<typename StraightOp, typename PremultipliedOp, typename Modulation>
+void Canvas::BlitTextured(const IImage& img, const IImage& tex, Point texoffset, const BlitItem* items, int count, const Modulation& modulation)
 {
-	REQUIRE(img.HasColors());
+	if(tex.IsPremultiplied())
+		BlitColors<StraightOp, PremultipliedOp>(img.GetSize(), items, count, MonoTexturedSource<CoverageModulatesColor>(img, tex, texoffset), true, modulation);
+	else
+		BlitColors<StraightOp, PremultipliedOp>(img.GetSize(), items, count, MonoTexturedSource<CoverageModulatesAlpha>(img, tex, texoffset), false, modulation);
+}
 
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
+// Integer division which rounds down or up, also for negative numbers
+static inline int64_t FloorDiv(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+	return ((a % b != 0) && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+static inline int64_t CeilDiv(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+	return ((a % b != 0) && ((a < 0) == (b < 0))) ? q + 1 : q;
+}
+
+// Limits the pixels [first, last] of a row to those where the fixed-point image coordinate
+// p + i * dp of pixel i lies within [0, limit). Returns false when there are none.
+static bool ClipTransformedRow(int64_t p, int64_t dp, int64_t limit, int64_t& first, int64_t& last)
+{
+	if(dp == 0)
+		return (p >= 0) && (p < limit);
 
-	// Draw image
-	ColorSampler sampler = img.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	if(dp > 0)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
-			AddPixel(drawrect.x + x, drawrect.y + y, sampler(imgrect.x + x, imgrect.y + y));
+		first = std::max(first, CeilDiv(-p, dp));
+		last = std::min(last, FloorDiv(limit - 1 - p, dp));
 	}
+	else
+	{
+		first = std::max(first, CeilDiv(limit - 1 - p, dp));
+		last = std::min(last, FloorDiv(-p, dp));
+	}
+	return first <= last;
 }
 
-void Canvas::DrawColorImageMask(Point pos, const IImage& img, Rect imgrect)
+bool Canvas::PrepareTransformedDraw(const IImage& img, const Transform& transform, Point origin, int& left, int& top, int& right, int& bottom) const
 {
-	REQUIRE(img.HasColors());
+	if(IsClipEmpty() || !transform.IsInvertible())
+		return false;
 
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
+	// Transforms that shrink the image below 1/32768 of its size would overflow the fixed-point
+	// steps. There is nothing to see of the image anyway.
+	Transform inverse = transform.Inverse();
+	const float maxstep = 32768.0f;
+	if(!(std::fabs(inverse.a) < maxstep) || !(std::fabs(inverse.b) < maxstep) ||
+	   !(std::fabs(inverse.c) < maxstep) || !(std::fabs(inverse.d) < maxstep))
+		return false;
+
+	// Bounding box of the image corners relative to the origin. Pixels are drawn when their center
+	// lies inside the image, so this leaves out pixels which only touch the box on the outside.
+	// Coordinates are limited to the clip rectangle first, so that they can't overflow an int.
+	float w = static_cast<float>(img.Width());
+	float h = static_cast<float>(img.Height());
+	float xs[4] = { transform.MapX(0.0f, 0.0f), transform.MapX(w, 0.0f), transform.MapX(0.0f, h), transform.MapX(w, h) };
+	float ys[4] = { transform.MapY(0.0f, 0.0f), transform.MapY(w, 0.0f), transform.MapY(0.0f, h), transform.MapY(w, h) };
+	float minx = std::clamp(*std::min_element(xs, xs + 4), static_cast<float>(clipleft - origin.x), static_cast<float>(clipright + 1 - origin.x));
+	float maxx = std::clamp(*std::max_element(xs, xs + 4), static_cast<float>(clipleft - origin.x), static_cast<float>(clipright + 1 - origin.x));
+	float miny = std::clamp(*std::min_element(ys, ys + 4), static_cast<float>(cliptop - origin.y), static_cast<float>(clipbottom + 1 - origin.y));
+	float maxy = std::clamp(*std::max_element(ys, ys + 4), static_cast<float>(cliptop - origin.y), static_cast<float>(clipbottom + 1 - origin.y));
+	left = static_cast<int>(std::floor(minx)) + origin.x;
+	top = static_cast<int>(std::floor(miny)) + origin.y;
+	right = static_cast<int>(std::ceil(maxx)) - 1 + origin.x;
+	bottom = static_cast<int>(std::ceil(maxy)) - 1 + origin.y;
+	return (left <= right) && (top <= bottom);
+}
+
+template<typename Op, typename Source, typename Modulation>
+void Canvas::BlitTransformed(const IImage& img, const Transform& transform, Point origin, Source source, const Modulation& modulation)
+{
+	int left, top, right, bottom;
+	if(!PrepareTransformedDraw(img, transform, origin, left, top, right, bottom))
 		return;
 
-	// Draw image
-	ColorSampler sampler = img.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	// The inverse maps canvas pixels back onto the image. Every pixel to the right moves the same
+	// distance through the image, so the rows step through it without multiplying per pixel.
+	Transform inverse = transform.Inverse();
+	int64_t du = std::llround(static_cast<double>(inverse.a) * 65536.0);
+	int64_t dv = std::llround(static_cast<double>(inverse.c) * 65536.0);
+	int64_t limitu = static_cast<int64_t>(img.Width()) << 16;
+	int64_t limitv = static_cast<int64_t>(img.Height()) << 16;
+
+	// Steps larger than the image leave a single pixel per row, which the source doesn't step from.
+	// Limiting them keeps the step after the last pixel from overflowing.
+	const int64_t maxstep = static_cast<int64_t>(BLIT_MAX_TRANSFORMED_SIZE) << 16;
+	int stepu = static_cast<int>(std::clamp(du, -maxstep, maxstep));
+	int stepv = static_cast<int>(std::clamp(dv, -maxstep, maxstep));
+
+	Color scratch[BLIT_CHUNK_SIZE];
+	for(int y = top; y <= bottom; y++)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
-			MaskPixel(drawrect.x + x, drawrect.y + y, sampler(imgrect.x + x, imgrect.y + y));
+		// Image coordinates of the center of the leftmost pixel
+		double cx = static_cast<double>(left - origin.x) + 0.5;
+		double cy = static_cast<double>(y - origin.y) + 0.5;
+		int64_t u = std::llround((inverse.a * cx + inverse.b * cy + inverse.tx) * 65536.0);
+		int64_t v = std::llround((inverse.c * cx + inverse.d * cy + inverse.ty) * 65536.0);
+
+		// Only draw the pixels that sample inside the image
+		int64_t first = 0;
+		int64_t last = right - left;
+		if(!ClipTransformedRow(u, du, limitu, first, last) || !ClipTransformedRow(v, dv, limitv, first, last))
+			continue;
+
+		int x1 = left + static_cast<int>(first);
+		int x2 = left + static_cast<int>(last);
+		int su = static_cast<int>(u + first * du);
+		int sv = static_cast<int>(v + first * dv);
+		Color* dst = &pixels[y * stride + x1];
+		for(int x = 0; x <= x2 - x1; x += BLIT_CHUNK_SIZE)
+		{
+			int chunk = std::min(BLIT_CHUNK_SIZE, x2 - x1 + 1 - x);
+			const Color* row = source.Row(su, sv, stepu, stepv, chunk, scratch);
+			row = modulation.Apply(row, chunk, scratch);
+			Op::Apply(dst + x, row, chunk);
+			su += chunk * stepu;
+			sv += chunk * stepv;
+		}
+		AddDamage(x1, y, x2, y);
 	}
 }
 
-void Canvas::DrawColorImageMod(Point pos, const IImage& img, Color mod, Rect imgrect)
+template<typename StraightOp, typename PremultipliedOp, typename Source, typename Modulation>
+void Canvas::BlitTransformedColors(const IImage& img, const Transform& transform, Point origin, Source source, bool sourcepremultiplied, const Modulation& modulation)
 {
-	REQUIRE(img.HasColors());
+	if(IsPremultiplied())
+	{
+		if(sourcepremultiplied)
+			BlitTransformed<PremultipliedOp>(img, transform, origin, source, modulation);
+		else
+			BlitTransformed<PremultipliedOp>(img, transform, origin, source, ChainedModulation<PremultiplyModulation, Modulation>(PremultiplyModulation(), modulation));
+	}
+	else
+	{
+		if(sourcepremultiplied)
+			BlitTransformed<StraightOp>(img, transform, origin, source, ChainedModulation<UnpremultiplyModulation, Modulation>(UnpremultiplyModulation(), modulation));
+		else
+			BlitTransformed<StraightOp>(img, transform, origin, source, modulation);
+	}
+}
 
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
+template<typename Filter>
+void Canvas::DrawFiltered(const DrawCommand& command)
+{
+	const IImage& img = *command.img;
+	const Transform& transform = command.transform;
+	if(command.op == DrawOp::ColorImageTransformed)
+	{
+		TransformedColorSource<Filter> source(img);
+		WithBlendModeOps(command.mode, [&](auto straightop, auto premultipliedop)
+		{
+			BlitTransformedColors<decltype(straightop), decltype(premultipliedop)>(img, transform, command.origin, source, img.IsPremultiplied(), NoModulation());
+		});
 		return;
+	}
 
-	// Draw image
-	ColorSampler sampler = img.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	// The coverage applies to the color as in DrawItems
+	Color color = command.color;
+	switch(command.mode)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
-        {
-            Color c = sampler(imgrect.x + x, imgrect.y + y);
-            c.ModulateRGBA(mod);
-            // We use BlendPixel to handle the alpha transparency of the resulting color
-			BlendPixel(drawrect.x + x, drawrect.y + y, c); 
-        }
+		case BlendMode::Opaque:
+			BlitTransformedColors<OpaqueOp, OpaqueOp>(img, transform, command.origin, TransformedMonoSource<Filter, CoverageModulatesColor>(img, color), false, NoModulation());
+			break;
+
+		case BlendMode::Mask:
+			BlitTransformedColors<MaskOp, MaskOp>(img, transform, command.origin, TransformedMonoSource<Filter, CoverageIsAlpha>(img, color), false, NoModulation());
+			break;
+
+		default:
+			// The other modes blend by the coverage like MonoImageBlend
+			WithBlendModeOps(command.mode, [&](auto straightop, auto premultipliedop)
+			{
+				if(IsPremultiplied())
+					BlitTransformed<decltype(premultipliedop)>(img, transform, command.origin, TransformedMonoSource<Filter, CoverageModulatesColor>(img, CanvasColor(color)), NoModulation());
+				else
+					BlitTransformed<decltype(straightop)>(img, transform, command.origin, TransformedMonoSource<Filter, CoverageModulatesAlpha>(img, color), NoModulation());
+			});
+			break;
 	}
 }
 
-void Canvas::DrawMonoImage(Point pos, const IImage& img, Color color, Rect imgrect)
+void Canvas::Record(DrawCommand command) const
 {
-	REQUIRE(img.HasColors() == false);
+	Rect clip = GetClip();
+	command.clip = Rect(clip.x + ownerpos.x, clip.y + ownerpos.y, clip.width, clip.height);
+	command.pos = command.pos.Offset(ownerpos.x, ownerpos.y);
+	command.pos2 = command.pos2.Offset(ownerpos.x, ownerpos.y);
+	command.origin = command.origin.Offset(ownerpos.x, ownerpos.y);
+	for(Point& p : command.points)
+		p = p.Offset(ownerpos.x, ownerpos.y);
+	owner->recording->Add(command);
+}
 
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
+void Canvas::DrawImage(DrawOp op, Point pos, const IImage& img, Rect imgrect, Color color, const IImage* tex, Point texoffset, BlendMode mode)
+{
+	DrawCommand command;
+	command.op = op;
+	command.img = &img;
+	command.tex = tex;
+	command.color = color;
+	command.texoffset = texoffset;
+	command.mode = mode;
+	if(owner->recording)
+	{
+		command.pos = pos;
+		command.imgrect = imgrect;
+		Record(command);
 		return;
+	}
 
-	// Draw image
-	MonoSampler sampler = img.GetMonoSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	BlitItem item(pos, imgrect);
+	DrawItems(command, &item, 1);
+}
+
+void Canvas::DrawItems(const DrawCommand& state, const BlitItem* items, int count)
+{
+	if(state.op == DrawOp::RowsMode)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
+		// Opaque colors are the same either way, so they never need converting
+		const IRowSource& rows = *state.rows;
+		bool premultiplied = rows.IsOpaque() ? IsPremultiplied() : rows.IsPremultiplied();
+		WithBlendModeOps(state.mode, [&](auto straightop, auto premultipliedop)
 		{
-			Color c = color;
-			c.ModulateRGBA(sampler(imgrect.x + x, imgrect.y + y));
-			SetPixel(drawrect.x + x, drawrect.y + y, c);
-		}
+			BlitColors<decltype(straightop), decltype(premultipliedop)>(rows.GetSize(), items, count, RowSource(rows), premultiplied, NoModulation());
+		});
+		return;
+	}
+
+	const IImage& img = *state.img;
+	switch(state.op)
+	{
+		case DrawOp::ColorImage:
+			BlitColors<OpaqueOp, OpaqueOp>(img.GetSize(), items, count, ColorSource(img), img.IsPremultiplied(), NoModulation());
+			break;
+
+		case DrawOp::ColorImageBlend:
+			BlitColors<BlendOp, BlendPremultipliedOp>(img.GetSize(), items, count, ColorSource(img), img.IsPremultiplied(), NoModulation());
+			break;
+
+		case DrawOp::ColorImageAdd:
+			BlitColors<AddOp, AddPremultipliedOp>(img.GetSize(), items, count, ColorSource(img), img.IsPremultiplied(), NoModulation());
+			break;
+
+		case DrawOp::ColorImageMask:
+			BlitColors<MaskOp, MaskOp>(img.GetSize(), items, count, ColorSource(img), img.IsPremultiplied(), NoModulation());
+			break;
+
+		case DrawOp::ColorImageMod:
+			// We blend to handle the alpha transparency of the resulting colors
+			BlitColors<BlendOp, BlendPremultipliedOp>(img.GetSize(), items, count, ColorSource(img), img.IsPremultiplied(), ColorModulation(CanvasColor(state.color)));
+			break;
+
+		case DrawOp::ColorImageMode:
+			WithBlendModeOps(state.mode, [&](auto straightop, auto premultipliedop)
+			{
+				BlitColors<decltype(straightop), decltype(premultipliedop)>(img.GetSize(), items, count, ColorSource(img), img.IsPremultiplied(), NoModulation());
+			});
+			break;
+
+		case DrawOp::MonoImage:
+			BlitColors<OpaqueOp, OpaqueOp>(img.GetSize(), items, count, MonoSource<CoverageModulatesColor>(img, state.color), false, NoModulation());
+			break;
+
+		case DrawOp::MonoImageBlend:
+			// With premultiplied alpha the coverage modulates the whole premultiplied color
+			if(IsPremultiplied())
+				Blit<BlendPremultipliedOp>(img.GetSize(), items, count, MonoSource<CoverageModulatesColor>(img, CanvasColor(state.color)), NoModulation());
+			else
+				Blit<BlendOp>(img.GetSize(), items, count, MonoSource<CoverageModulatesAlpha>(img, state.color), NoModulation());
+			break;
+
+		case DrawOp::MonoImageAdd:
+			if(IsPremultiplied())
+				Blit<AddPremultipliedOp>(img.GetSize(), items, count, MonoSource<CoverageModulatesColor>(img, CanvasColor(state.color)), NoModulation());
+			else
+				Blit<AddOp>(img.GetSize(), items, count, MonoSource<CoverageModulatesAlpha>(img, state.color), NoModulation());
+			break;
+
+		case DrawOp::MonoImageMask:
+			BlitColors<MaskOp, MaskOp>(img.GetSize(), items, count, MonoSource<CoverageIsAlpha>(img, state.color), false, NoModulation());
+			break;
+
+		case DrawOp::MonoImageMode:
+			// The coverage applies to the color like with MonoImageBlend
+			WithBlendModeOps(state.mode, [&](auto straightop, auto premultipliedop)
+			{
+				if(IsPremultiplied())
+					Blit<decltype(premultipliedop)>(img.GetSize(), items, count, MonoSource<CoverageModulatesColor>(img, CanvasColor(state.color)), NoModulation());
+				else
+					Blit<decltype(straightop)>(img.GetSize(), items, count, MonoSource<CoverageModulatesAlpha>(img, state.color), NoModulation());
+			});
+			break;
+
+		case DrawOp::MonoTextured:
+			BlitTextured<OpaqueOp, OpaqueOp>(img, *state.tex, state.texoffset, items, count, NoModulation());
+			break;
+
+		case DrawOp::MonoTexturedMask:
+			BlitTextured<MaskOp, MaskOp>(img, *state.tex, state.texoffset, items, count, NoModulation());
+			break;
+
+		case DrawOp::MonoTexturedBlend:
+			BlitTextured<BlendOp, BlendPremultipliedOp>(img, *state.tex, state.texoffset, items, count, NoModulation());
+			break;
+
+		case DrawOp::MonoTexturedAdd:
+			BlitTextured<AddOp, AddPremultipliedOp>(img, *state.tex, state.texoffset, items, count, NoModulation());
+			break;
+
+		case DrawOp::MonoTexturedMod:
+			BlitTextured<OpaqueOp, OpaqueOp>(img, *state.tex, state.texoffset, items, count, ColorModulation(CanvasColor(state.color)));
+			break;
+
+		case DrawOp::MonoTexturedModMask:
+			BlitTextured<MaskOp, MaskOp>(img, *state.tex, state.texoffset, items, count, ColorModulation(CanvasColor(state.color)));
+			break;
+
+		case DrawOp::MonoTexturedModBlend:
+			BlitTextured<BlendOp, BlendPremultipliedOp>(img, *state.tex, state.texoffset, items, count, ColorModulation(CanvasColor(state.color)));
+			break;
+
+		case DrawOp::MonoTexturedModAdd:
+			BlitTextured<AddOp, AddPremultipliedOp>(img, *state.tex, state.texoffset, items, count, ColorModulation(CanvasColor(state.color)));
+			break;
+
+		case DrawOp::ColorImageTransformed:
+		case DrawOp::MonoImageTransformed:
+			if(state.sampling == Sampling::Bilinear)
+				DrawFiltered<BilinearFilter>(state);
+			else
+				DrawFiltered<NearestFilter>(state);
+			break;
+
+		default:
+			NOT_SUPPORTED;
 	}
 }
 
-void Canvas::DrawMonoImageBlend(Point pos, const IImage& img, Color color, Rect imgrect)
+void Canvas::DrawItemsMasked(const DrawCommand& state, Point pos, const BitMask& mask, Point maskpos)
 {
-	REQUIRE(img.HasColors() == false);
-
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
+	// The area where the image, the mask and the clip rectangle overlap
+	const IImage& img = *state.img;
+	int left = std::max({ pos.x, maskpos.x, clipleft });
+	int top = std::max({ pos.y, maskpos.y, cliptop });
+	int right = std::min({ pos.x + img.Width() - 1, maskpos.x + mask.Width() - 1, clipright });
+	int bottom = std::min({ pos.y + img.Height() - 1, maskpos.y + mask.Height() - 1, clipbottom });
+	if((left > right) || (top > bottom))
 		return;
 
-	// Draw image
-	Color c = color;
-	MonoSampler sampler = img.GetMonoSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	BlitItem items[BLIT_CHUNK_SIZE];
+	int count = 0;
+	mask.ForEachRun(left - maskpos.x, top - maskpos.y, right - maskpos.x, bottom - maskpos.y, [&](int y, int x1, int x2)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
+		Point p(x1 + maskpos.x, y + maskpos.y);
+		items[count++] = BlitItem(p, Rect(p.x - pos.x, p.y - pos.y, x2 - x1 + 1, 1));
+		if(count == BLIT_CHUNK_SIZE)
 		{
-			uint imagealpha = static_cast<uint>(sampler(imgrect.x + x, imgrect.y + y));
-			c.a = static_cast<byte>((static_cast<uint>(color.a) * imagealpha) / 255u);
-			BlendPixel(drawrect.x + x, drawrect.y + y, c);
+			DrawItems(state, items, count);
+			count = 0;
 		}
-	}
+	});
+	if(count > 0)
+		DrawItems(state, items, count);
 }
 
-void Canvas::DrawMonoImageAdd(Point pos, const IImage& img, Color color, Rect imgrect)
+void Canvas::DrawTransformed(DrawCommand command)
 {
-	REQUIRE(img.HasColors() == false);
-
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
-
-	// Draw image
-	Color c = color;
-	MonoSampler sampler = img.GetMonoSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	if(owner->recording)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
+		// The draw list needs to know the area we draw in
+		int left, top, right, bottom;
+		if(PrepareTransformedDraw(*command.img, command.transform, command.origin, left, top, right, bottom))
 		{
-			uint imagealpha = static_cast<uint>(sampler(imgrect.x + x, imgrect.y + y));
-			c.a = static_cast<byte>((static_cast<uint>(color.a) * imagealpha) / 255u);
-			AddPixel(drawrect.x + x, drawrect.y + y, c);
+			command.pos = Point(left, top);
+			command.pos2 = Point(right, bottom);
+			Record(command);
 		}
+		return;
 	}
+
+	DrawItems(command, nullptr, 0);
 }
 
-void Canvas::DrawMonoImageMask(Point pos, const IImage& img, Color color, Rect imgrect)
+// Returns the mip level of the image to draw with the transform, which is the smallest level
+// that is at least the drawn size, and changes the transform to draw that level
+static const IImage& SelectMip(const IImage& img, Transform& transform)
 {
-	REQUIRE(img.HasColors() == false);
+	if(img.MipCount() <= 1)
+		return img;
 
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
-
-	// Draw image
-	Color c = color;
-	MonoSampler sampler = img.GetMonoSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+	// The drawn size of an image pixel, along the longest of its sides
+	float scale = std::max(std::hypot(transform.a, transform.c), std::hypot(transform.b, transform.d));
+	int level = 0;
+	while(((level + 1) < img.MipCount()) && (scale <= 0.5f))
 	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			c.a = sampler(imgrect.x + x, imgrect.y + y);
-			MaskPixel(drawrect.x + x, drawrect.y + y, c);
-		}
+		scale *= 2.0f;
+		level++;
 	}
+	if(level == 0)
+		return img;
+
+	const IImage& mip = img.GetMip(level);
+	transform = transform * Transform::Scale(static_cast<float>(img.Width()) / static_cast<float>(mip.Width()),
+		static_cast<float>(img.Height()) / static_cast<float>(mip.Height()));
+	return mip;
 }
 
-void Canvas::DrawMonoTextured(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
+void Canvas::DrawColorImageTransformed(const IImage& img, const Transform& transform, Sampling sampling, BlendMode mode)
+{
+	REQUIRE(img.HasColors());
+	DrawCommand command;
+	command.transform = transform;
+	const IImage& mip = SelectMip(img, command.transform);
+	REQUIRE(mip.Width() <= BLIT_MAX_TRANSFORMED_SIZE);
+	REQUIRE(mip.Height() <= BLIT_MAX_TRANSFORMED_SIZE);
+	command.op = DrawOp::ColorImageTransformed;
+	command.img = &mip;
+	command.sampling = sampling;
+	command.mode = mode;
+	DrawTransformed(command);
+}
+
+void Canvas::DrawMonoImageTransformed(const IImage& img, Color color, const Transform& transform, Sampling sampling, BlendMode mode)
 {
 	REQUIRE(img.HasColors() == false);
-	REQUIRE(tex.HasColors() == true);
+	DrawCommand command;
+	command.transform = transform;
+	const IImage& mip = SelectMip(img, command.transform);
+	REQUIRE(mip.Width() <= BLIT_MAX_TRANSFORMED_SIZE);
+	REQUIRE(mip.Height() <= BLIT_MAX_TRANSFORMED_SIZE);
+	command.op = DrawOp::MonoImageTransformed;
+	command.img = &mip;
+	command.color = color;
+	command.sampling = sampling;
+	command.mode = mode;
+	DrawTransformed(command);
+}
 
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
+void Canvas::DrawColorImage(Point pos, const IImage& img, Rect imgrect)
+{
+	REQUIRE(img.HasColors());
+	DrawImage(DrawOp::ColorImage, pos, img, imgrect);
+}
 
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
+void Canvas::DrawColorImageBlend(Point pos, const IImage& img, Rect imgrect)
+{
+	REQUIRE(img.HasColors());
+	DrawImage(DrawOp::ColorImageBlend, pos, img, imgrect);
+}
+
+void Canvas::DrawColorImageAdd(Point pos, const IImage& img, Rect imgrect)
+{
+	REQUIRE(img.HasColors());
+	DrawImage(DrawOp::ColorImageAdd, pos, img, imgrect);
+}
 
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+void Canvas::DrawColorImageMask(Point pos, const IImage& img, Rect imgrect)
+{
+	REQUIRE(img.HasColors());
+	DrawImage(DrawOp::ColorImageMask, pos, img, imgrect);
+}
+
+void Canvas::DrawColorImage(Point pos, const IImage& img, BlendMode mode, Rect imgrect)
+{
+	REQUIRE(img.HasColors());
+	DrawOp op = ColorImageOp(mode);
+	DrawImage(op, pos, img, imgrect, Color(), nullptr, Point(), (op == DrawOp::ColorImageMode) ? mode : BlendMode::Opaque);
+}
+
+void Canvas::DrawRows(Point pos, const IRowSource& rows, BlendMode mode)
+{
+	DrawCommand command;
+	command.op = DrawOp::RowsMode;
+	command.rows = &rows;
+	command.mode = mode;
+	command.pos = pos;
+	command.imgrect = Rect(Point(), rows.GetSize());
+	if(owner->recording)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			SetPixel(drawrect.x + x, drawrect.y + y, c);
-		}
+		Record(command);
+		return;
 	}
+
+	BlitItem item(command.pos, command.imgrect);
+	DrawItems(command, &item, 1);
 }
 
-void Canvas::DrawMonoTexturedMask(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
+void Canvas::DrawColorImageMod(Point pos, const IImage& img, Color mod, Rect imgrect)
+{
+	REQUIRE(img.HasColors());
+	DrawImage(DrawOp::ColorImageMod, pos, img, imgrect, mod);
+}
+
+void Canvas::DrawMonoImage(Point pos, const IImage& img, Color color, Rect imgrect)
 {
 	REQUIRE(img.HasColors() == false);
-	REQUIRE(tex.HasColors() == true);
+	DrawImage(DrawOp::MonoImage, pos, img, imgrect, color);
+}
 
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
+void Canvas::DrawMonoImageBlend(Point pos, const IImage& img, Color color, Rect imgrect)
+{
+	REQUIRE(img.HasColors() == false);
+	DrawImage(DrawOp::MonoImageBlend, pos, img, imgrect, color);
+}
 
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
+void Canvas::DrawMonoImageAdd(Point pos, const IImage& img, Color color, Rect imgrect)
+{
+	REQUIRE(img.HasColors() == false);
+	DrawImage(DrawOp::MonoImageAdd, pos, img, imgrect, color);
+}
 
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
-	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			MaskPixel(drawrect.x + x, drawrect.y + y, c);
-		}
-	}
+void Canvas::DrawMonoImageMask(Point pos, const IImage& img, Color color, Rect imgrect)
+{
+	REQUIRE(img.HasColors() == false);
+	DrawImage(DrawOp::MonoImageMask, pos, img, imgrect, color);
 }
 
-void Canvas::DrawMonoTexturedBlend(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
+void Canvas::DrawMonoImage(Point pos, const IImage& img, Color color, BlendMode mode, Rect imgrect)
 {
 	REQUIRE(img.HasColors() == false);
-	REQUIRE(tex.HasColors() == true);
+	DrawOp op = MonoImageOp(mode);
+	DrawImage(op, pos, img, imgrect, color, nullptr, Point(), (op == DrawOp::MonoImageMode) ? mode : BlendMode::Opaque);
+}
 
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
+void Canvas::DrawColorImage(Point pos, const IImage& img, BlendMode mode, const BitMask& mask, Point maskpos)
+{
+	REQUIRE(img.HasColors());
+	DrawCommand command;
+	command.op = ColorImageOp(mode);
+	command.img = &img;
+	command.mode = mode;
+	DrawItemsMasked(command, pos, mask, maskpos);
+}
 
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
+void Canvas::DrawMonoImage(Point pos, const IImage& img, Color color, BlendMode mode, const BitMask& mask, Point maskpos)
+{
+	REQUIRE(img.HasColors() == false);
+	DrawCommand command;
+	command.op = MonoImageOp(mode);
+	command.img = &img;
+	command.color = color;
+	command.mode = mode;
+	DrawItemsMasked(command, pos, mask, maskpos);
+}
 
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
+void Canvas::FillMask(const BitMask& mask, Point maskpos, Color color, BlendMode mode)
+{
+	// The area of the mask inside the clip rectangle
+	int left = std::max(maskpos.x, clipleft);
+	int top = std::max(maskpos.y, cliptop);
+	int right = std::min(maskpos.x + mask.Width() - 1, clipright);
+	int bottom = std::min(maskpos.y + mask.Height() - 1, clipbottom);
+	if((left > right) || (top > bottom))
+		return;
+
+	ColorSpanFunction span = GetColorSpan(mode);
+	color = CanvasColor(color);
+	mask.ForEachRun(left - maskpos.x, top - maskpos.y, right - maskpos.x, bottom - maskpos.y, [&](int y, int x1, int x2)
 	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			BlendPixel(drawrect.x + x, drawrect.y + y, c);
-		}
-	}
+		FillRow(y + maskpos.y, x1 + maskpos.x, x2 + maskpos.x, color, span);
+	});
 }
 
-void Canvas::DrawMonoTexturedAdd(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
+void Canvas::DrawMonoTextured(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
 {
 	REQUIRE(img.HasColors() == false);
 	REQUIRE(tex.HasColors() == true);
+	DrawImage(DrawOp::MonoTextured, pos, img, imgrect, Color(), &tex, texoffset);
+}
 
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
+void Canvas::DrawMonoTexturedMask(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
+{
+	REQUIRE(img.HasColors() == false);
+	REQUIRE(tex.HasColors() == true);
+	DrawImage(DrawOp::MonoTexturedMask, pos, img, imgrect, Color(), &tex, texoffset);
+}
 
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
+void Canvas::DrawMonoTexturedBlend(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
+{
+	REQUIRE(img.HasColors() == false);
+	REQUIRE(tex.HasColors() == true);
+	DrawImage(DrawOp::MonoTexturedBlend, pos, img, imgrect, Color(), &tex, texoffset);
+}
 
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
-	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			AddPixel(drawrect.x + x, drawrect.y + y, c);
-		}
-	}
+void Canvas::DrawMonoTexturedAdd(Point pos, const IImage& img, const IImage& tex, Point texoffset, Rect imgrect)
+{
+	REQUIRE(img.HasColors() == false);
+	REQUIRE(tex.HasColors() == true);
+	DrawImage(DrawOp::MonoTexturedAdd, pos, img, imgrect, Color(), &tex, texoffset);
 }
 
 void Canvas::DrawMonoTexturedMod(Point pos, const IImage& img, const IImage& tex, Color mod, Point texoffset, Rect imgrect)
 {
 	REQUIRE(img.HasColors() == false);
 	REQUIRE(tex.HasColors() == true);
-
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
-
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
-
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
-	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			c.ModulateRGBA(mod);
-			SetPixel(drawrect.x + x, drawrect.y + y, c);
-		}
-	}
+	DrawImage(DrawOp::MonoTexturedMod, pos, img, imgrect, mod, &tex, texoffset);
 }
 
 void Canvas::DrawMonoTexturedModMask(Point pos, const IImage& img, const IImage& tex, Color mod, Point texoffset, Rect imgrect)
 {
 	REQUIRE(img.HasColors() == false);
 	REQUIRE(tex.HasColors() == true);
-
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
-
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
-
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
-	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			c.ModulateRGBA(mod);
-			MaskPixel(drawrect.x + x, drawrect.y + y, c);
-		}
-	}
+	DrawImage(DrawOp::MonoTexturedModMask, pos, img, imgrect, mod, &tex, texoffset);
 }
 
 void Canvas::DrawMonoTexturedModBlend(Point pos, const IImage& img, const IImage& tex, Color mod, Point texoffset, Rect imgrect)
 {
 	REQUIRE(img.HasColors() == false);
 	REQUIRE(tex.HasColors() == true);
-
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
-		return;
-
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
-
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
-	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			c.ModulateRGBA(mod);
-			BlendPixel(drawrect.x + x, drawrect.y + y, c);
-		}
-	}
+	DrawImage(DrawOp::MonoTexturedModBlend, pos, img, imgrect, mod, &tex, texoffset);
 }
 
 void Canvas::DrawMonoTexturedModAdd(Point pos, const IImage& img, const IImage& tex, Color mod, Point texoffset, Rect imgrect)
 {
 	REQUIRE(img.HasColors() == false);
 	REQUIRE(tex.HasColors() == true);
+	DrawImage(DrawOp::MonoTexturedModAdd, pos, img, imgrect, mod, &tex, texoffset);
+}
 
-	Rect origimgrect = imgrect;
-	Rect drawrect;
-	if(!PrepareImageDraw(pos, img, imgrect, drawrect))
+void Canvas::DrawLine(Point p1, Point p2, Color color)
+{
+	if(owner->recording)
+	{
+		DrawCommand command;
+		command.op = DrawOp::Line;
+		command.color = color;
+		command.pos = p1;
+		command.pos2 = p2;
+		Record(command);
 		return;
+	}
 
-	// Adjust textoffset by the same amount as imgrect was adjusted
-	texoffset.x += imgrect.x - origimgrect.x;
-	texoffset.y += imgrect.y - origimgrect.y;
+	// Completely outside view?
+	if(!IsInClip(Point(std::min(p1.x, p2.x), std::min(p1.y, p2.y)), Point(std::max(p1.x, p2.x), std::max(p1.y, p2.y))))
+		return;
 
-	// Draw image
-	MonoSampler imgsampler = img.GetMonoSampler();
-	ColorSampler texsampler = tex.GetColorSampler();
-	for(int y = 0; y <= drawrect.height; y++)
-	{
-		for(int x = 0; x <= drawrect.width; x++)
-		{
-			int tx = (texoffset.x + x) % tex.Width();
-			int ty = (texoffset.y + y) % tex.Height();
-			Color c = Color(texsampler(tx, ty), imgsampler(imgrect.x + x, imgrect.y + y));
-			c.ModulateRGBA(mod);
-			AddPixel(drawrect.x + x, drawrect.y + y, c);
-		}
-	}
-}
+	// SetPixel takes the color as it is stored
+	color = CanvasColor(color);
 
-void Canvas::DrawLine(Point p1, Point p2, Color color)
-{
 	// Bresenham's line algorithm
 	int dx = abs(p2.x - p1.x);
 	int dy = abs(p2.y - p1.y);
@@ -571,7 +1373,7 @@ void Canvas::DrawLine(Point p1, Point p2, Color color)
 	while (true)
 	{
 		// Draw pixel if within bounds
-		if (x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
+		if (IsInClip(x, y))
 			SetPixel(x, y, color);
 		
 		if (x == p2.x && y == p2.y)
@@ -593,6 +1395,21 @@ void Canvas::DrawLine(Point p1, Point p2, Color color)
 
 void Canvas::DrawLineBlend(Point p1, Point p2, Color color)
 {
+	if(owner->recording)
+	{
+		DrawCommand command;
+		command.op = DrawOp::LineBlend;
+		command.color = color;
+		command.pos = p1;
+		command.pos2 = p2;
+		Record(command);
+		return;
+	}
+
+	// Completely outside view?
+	if(!IsInClip(Point(std::min(p1.x, p2.x), std::min(p1.y, p2.y)), Point(std::max(p1.x, p2.x), std::max(p1.y, p2.y))))
+		return;
+
 	// Bresenham's line algorithm with blending
 	int dx = abs(p2.x - p1.x);
 	int dy = abs(p2.y - p1.y);
@@ -606,7 +1423,7 @@ void Canvas::DrawLineBlend(Point p1, Point p2, Color color)
 	while (true)
 	{
 		// Draw pixel if within bounds
-		if (x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
+		if (IsInClip(x, y))
 			BlendPixel(x, y, color);
 		
 		if (x == p2.x && y == p2.y)
@@ -628,53 +1445,179 @@ void Canvas::DrawLineBlend(Point p1, Point p2, Color color)
 
 void Canvas::CopyRegion(const Canvas& source, Rect sourceRect, Point destPoint)
 {
-	// Clamp source rect to source canvas bounds
-	if (sourceRect.x < 0)
+	// Copy only the area that the source has and we can draw in
+	int dx = destPoint.x - sourceRect.x;
+	int dy = destPoint.y - sourceRect.y;
+	int left = std::max(std::max(sourceRect.Left(), source.boundsleft), clipleft - dx);
+	int top = std::max(std::max(sourceRect.Top(), source.boundstop), cliptop - dy);
+	int right = std::min(std::min(sourceRect.Right(), source.boundsright), clipright - dx);
+	int bottom = std::min(std::min(sourceRect.Bottom(), source.boundsbottom), clipbottom - dy);
+	if((left > right) || (top > bottom))
+		return;
+
+	int count = right - left + 1;
+	const Color* src = &source.pixels[top * source.stride + left];
+	Color* dst = &pixels[(top + dy) * stride + left + dx];
+	if(source.owner == owner)
 	{
-		sourceRect.width += sourceRect.x;
-		sourceRect.x = 0;
+		// The areas can overlap in the shared buffer. When the destination comes after the source,
+		// the rows are moved from the bottom up, so that no row is overwritten before it is moved.
+		if(dst > src)
+		{
+			for(int y = bottom - top; y >= 0; y--)
+				memmove(dst + y * stride, src + y * stride, count * sizeof(Color));
+		}
+		else
+		{
+			for(int y = 0; y <= bottom - top; y++)
+				memmove(dst + y * stride, src + y * stride, count * sizeof(Color));
+		}
 	}
-	if (sourceRect.y < 0)
+	else
 	{
-		sourceRect.height += sourceRect.y;
-		sourceRect.y = 0;
+		// Converted when only one canvas has premultiplied alpha
+		for(int y = 0; y <= bottom - top; y++)
+			CopyPixels(dst + y * stride, IsPremultiplied(), src + y * source.stride, source.IsPremultiplied(), count);
 	}
-	if (sourceRect.Right() >= DISPLAY_WIDTH)
-		sourceRect.width = DISPLAY_WIDTH - sourceRect.x;
-	if (sourceRect.Bottom() >= DISPLAY_HEIGHT)
-		sourceRect.height = DISPLAY_HEIGHT - sourceRect.y;
-	
-	// Nothing to copy?
-	if (sourceRect.width <= 0 || sourceRect.height <= 0)
+	AddDamage(left + dx, top + dy, right + dx, bottom + dy);
+}
+
+void Canvas::Scroll(int dx, int dy, ScrollMode mode, Color fillcolor)
+{
+	if(IsClipEmpty())
 		return;
-	
-	// Copy pixels
-	for (int y = 0; y < sourceRect.height; y++)
+
+	int w = clipright - clipleft + 1;
+	int h = clipbottom - cliptop + 1;
+	Color* area = &pixels[cliptop * stride + clipleft];
+	if(mode == ScrollMode::Wrap)
 	{
-		int srcY = sourceRect.y + y;
-		int dstY = destPoint.y + y;
-		
-		// Skip if dest Y is out of bounds
-		if (dstY < 0 || dstY >= DISPLAY_HEIGHT)
-			continue;
-		
-		for (int x = 0; x < sourceRect.width; x++)
+		// Only the remainder matters when wrapping
+		dx %= w;
+		dy %= h;
+		if(dx < 0)
+			dx += w;
+		if(dy < 0)
+			dy += h;
+	}
+	if((dx == 0) && (dy == 0))
+		return;
+
+	if(mode == ScrollMode::Wrap)
+	{
+		scrollbuffer.resize(w);
+		Color* temp = scrollbuffer.data();
+		if(dy == 0)
 		{
-			int srcX = sourceRect.x + x;
-			int dstX = destPoint.x + x;
-			
-			// Skip if dest X is out of bounds
-			if (dstX < 0 || dstX >= DISPLAY_WIDTH)
-				continue;
-			
-			SetPixel(dstX, dstY, source.GetPixel(srcX, srcY));
+			// Rotate every row in place. The shorter of the two parts is put aside,
+			// the longer part is moved over and the shorter part goes in front of it.
+			for(int y = 0; y < h; y++)
+			{
+				Color* row = area + y * stride;
+				if(dx <= (w - dx))
+				{
+					memcpy(temp, row + (w - dx), dx * sizeof(Color));
+					memmove(row + dx, row, (w - dx) * sizeof(Color));
+					memcpy(row, temp, dx * sizeof(Color));
+				}
+				else
+				{
+					memcpy(temp, row, (w - dx) * sizeof(Color));
+					memmove(row, row + (w - dx), dx * sizeof(Color));
+					memcpy(row + dx, temp, (w - dx) * sizeof(Color));
+				}
+			}
+		}
+		else
+		{
+			// Row y gets row y - dy. The rows are moved in cycles that follow this back
+			// until they come around at the first row of the cycle, which was put aside.
+			// Every row is written once, in two parts: the part that moves right and the
+			// part that wraps around to the left.
+			auto putrow = [&](int y, const Color* src)
+			{
+				Color* dst = area + y * stride;
+				memcpy(dst + dx, src, (w - dx) * sizeof(Color));
+				memcpy(dst, src + (w - dx), dx * sizeof(Color));
+			};
+			int cycles = std::gcd(h, dy);
+			for(int start = 0; start < cycles; start++)
+			{
+				memcpy(temp, area + start * stride, w * sizeof(Color));
+				int y = start;
+				while(true)
+				{
+					int sy = (y >= dy) ? (y - dy) : (y - dy + h);
+					if(sy == start)
+					{
+						putrow(y, temp);
+						break;
+					}
+					putrow(y, area + sy * stride);
+					y = sy;
+				}
+			}
 		}
 	}
+	else if((std::abs(dx) >= w) || (std::abs(dy) >= h))
+	{
+		// Everything scrolls out
+		fillcolor = CanvasColor(fillcolor);
+		for(int y = 0; y < h; y++)
+			std::fill_n(area + y * stride, w, fillcolor);
+	}
+	else
+	{
+		// Move the rows that stay in place and fill the columns that scroll in
+		fillcolor = CanvasColor(fillcolor);
+		int count = w - std::abs(dx);
+		int srcx = std::max(-dx, 0);
+		int dstx = std::max(dx, 0);
+		int fillx = (dx > 0) ? 0 : count;
+		auto moverow = [&](int y)
+		{
+			Color* dst = area + y * stride;
+			memmove(dst + dstx, area + (y - dy) * stride + srcx, count * sizeof(Color));
+			std::fill_n(dst + fillx, std::abs(dx), fillcolor);
+		};
+
+		// When scrolling down, the rows are moved from the bottom up, so that
+		// every row is moved before it is overwritten
+		int first = std::max(dy, 0);
+		int last = h - 1 + std::min(dy, 0);
+		if(dy > 0)
+		{
+			for(int y = last; y >= first; y--)
+				moverow(y);
+		}
+		else
+		{
+			for(int y = first; y <= last; y++)
+				moverow(y);
+		}
+
+		// Fill the rows that scroll in
+		int filltop = (dy > 0) ? 0 : last + 1;
+		for(int y = filltop; y < filltop + std::abs(dy); y++)
+			std::fill_n(area + y * stride, w, fillcolor);
+	}
+	AddDamage(clipleft, cliptop, clipright, clipbottom);
 }
 
 void Canvas::WriteToFile(String filename) const
 {
+	PixelBuffer<Color> packed(width * height);
+	ReadPixels(packed.data());
+
 	vector<byte> recordbuffer;
-	lodepng::encode(recordbuffer, reinterpret_cast<const unsigned char*>(renderbuffer.data()), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	lodepng::encode(recordbuffer, reinterpret_cast<const unsigned char*>(packed.data()), width, height);
 	lodepng::save_file(recordbuffer, filename.stl());
 }
+
+void Canvas::ReadPixels(Color* dst) const
+{
+	if((boundsleft > 0) || (boundstop > 0) || (boundsright < (width - 1)) || (boundsbottom < (height - 1)))
+		std::fill_n(dst, width * height, Color(0, 0, 0, 0));
+	for(int y = boundstop; y <= boundsbottom; y++)
+		CopyPixels(&dst[y * width + boundsleft], false, &pixels[y * stride + boundsleft], IsPremultiplied(), boundsright - boundsleft + 1);
+}
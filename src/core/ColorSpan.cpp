@@ -0,0 +1,768 @@
+#include <cstring>
+#include "core/ColorSpan.h"
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define COLORSPAN_X86
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define COLORSPAN_X86
+#elif defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define COLORSPAN_NEON
+#endif
+
+#if defined(__SSE4_2__)
+	#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+	#include <arm_acle.h>
+#endif
+
+namespace
+{
+	/*
+	  Blend modes, with the scalar Color methods for straight and premultiplied colors. The vector
+	  paths specialize ModeStraight and ModePremultiplied for them, which compute the mode on the
+	  widened channels, and ModeKernel and ModePremultipliedKernel do the blending around that.
+	*/
+	struct MultiplyMode { static inline void Straight(Color& d, Color s) { d.Multiply(s); } static inline void Premultiplied(Color& d, Color s) { d.MultiplyPremultiplied(s); } };
+	struct ScreenMode { static inline void Straight(Color& d, Color s) { d.Screen(s); } static inline void Premultiplied(Color& d, Color s) { d.ScreenPremultiplied(s); } };
+	struct OverlayMode { static inline void Straight(Color& d, Color s) { d.Overlay(s); } static inline void Premultiplied(Color& d, Color s) { d.OverlayPremultiplied(s); } };
+	struct DarkenMode { static inline void Straight(Color& d, Color s) { d.Darken(s); } static inline void Premultiplied(Color& d, Color s) { d.DarkenPremultiplied(s); } };
+	struct LightenMode { static inline void Straight(Color& d, Color s) { d.Lighten(s); } static inline void Premultiplied(Color& d, Color s) { d.LightenPremultiplied(s); } };
+	struct DifferenceMode { static inline void Straight(Color& d, Color s) { d.Difference(s); } static inline void Premultiplied(Color& d, Color s) { d.DifferencePremultiplied(s); } };
+
+	/*
+	  Vector primitives. On x86 the pixels stay interleaved and are widened to 16-bit lanes
+	  (one pixel per 4 lanes), on ARM the pixels are de-interleaved into channel planes by vld4.
+	*/
+
+#if defined(__AVX2__)
+
+	typedef __m256i Vec;
+	constexpr int VEC_PIXELS = 8;
+
+	inline Vec Load(const Color* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	inline void Store(Color* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+	inline Vec Splat16(short v) { return _mm256_set1_epi16(v); }
+	inline Vec Splat32(int v) { return _mm256_set1_epi32(v); }
+	inline Vec UnpackLo(Vec v) { return _mm256_unpacklo_epi8(v, _mm256_setzero_si256()); }
+	inline Vec UnpackHi(Vec v) { return _mm256_unpackhi_epi8(v, _mm256_setzero_si256()); }
+	inline Vec Pack(Vec lo, Vec hi) { return _mm256_packus_epi16(lo, hi); }
+	inline Vec Add16(Vec a, Vec b) { return _mm256_add_epi16(a, b); }
+	inline Vec Sub16(Vec a, Vec b) { return _mm256_sub_epi16(a, b); }
+	inline Vec Mul16(Vec a, Vec b) { return _mm256_mullo_epi16(a, b); }
+	inline Vec Shr16By8(Vec v) { return _mm256_srli_epi16(v, 8); }
+	inline Vec Shr32By8(Vec v) { return _mm256_srli_epi32(v, 8); }
+	inline Vec Shr32By16(Vec v) { return _mm256_srli_epi32(v, 16); }
+	inline Vec And(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+	inline Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+	inline Vec AndNot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+	inline Vec AlphaLanes(Vec v) { return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, 0xFF), 0xFF); }
+	inline Vec AddSat8(Vec a, Vec b) { return _mm256_adds_epu8(a, b); }
+	inline Vec SubSat16(Vec a, Vec b) { return _mm256_subs_epu16(a, b); }
+	inline Vec Min16(Vec a, Vec b) { return _mm256_min_epi16(a, b); }
+	inline Vec Max16(Vec a, Vec b) { return _mm256_max_epi16(a, b); }
+	inline Vec CmpGt16(Vec a, Vec b) { return _mm256_cmpgt_epi16(a, b); }
+
+#elif defined(__SSE2__)
+
+	typedef __m128i Vec;
+	constexpr int VEC_PIXELS = 4;
+
+	inline Vec Load(const Color* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	inline void Store(Color* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+	inline Vec Splat16(short v) { return _mm_set1_epi16(v); }
+	inline Vec Splat32(int v) { return _mm_set1_epi32(v); }
+	inline Vec UnpackLo(Vec v) { return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+	inline Vec UnpackHi(Vec v) { return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+	inline Vec Pack(Vec lo, Vec hi) { return _mm_packus_epi16(lo, hi); }
+	inline Vec Add16(Vec a, Vec b) { return _mm_add_epi16(a, b); }
+	inline Vec Sub16(Vec a, Vec b) { return _mm_sub_epi16(a, b); }
+	inline Vec Mul16(Vec a, Vec b) { return _mm_mullo_epi16(a, b); }
+	inline Vec Shr16By8(Vec v) { return _mm_srli_epi16(v, 8); }
+	inline Vec Shr32By8(Vec v) { return _mm_srli_epi32(v, 8); }
+	inline Vec Shr32By16(Vec v) { return _mm_srli_epi32(v, 16); }
+	inline Vec And(Vec a, Vec b) { return _mm_and_si128(a, b); }
+	inline Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+	inline Vec AndNot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+	inline Vec AlphaLanes(Vec v) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF); }
+	inline Vec AddSat8(Vec a, Vec b) { return _mm_adds_epu8(a, b); }
+	inline Vec SubSat16(Vec a, Vec b) { return _mm_subs_epu16(a, b); }
+	inline Vec Min16(Vec a, Vec b) { return _mm_min_epi16(a, b); }
+	inline Vec Max16(Vec a, Vec b) { return _mm_max_epi16(a, b); }
+	inline Vec CmpGt16(Vec a, Vec b) { return _mm_cmpgt_epi16(a, b); }
+
+#endif
+
+#if defined(COLORSPAN_X86)
+
+	// The alpha byte of every pixel (Color is laid out as r, g, b, a in memory)
+	const int ALPHA_BITS = static_cast<int>(0xFF000000u);
+
+	inline Vec Broadcast(Color c)
+	{
+		int v;
+		memcpy(&v, &c, sizeof(v));
+		return Splat32(v);
+	}
+
+	// Same as DIV_255_FAST, for 16-bit lanes. Products of two bytes never overflow the lanes.
+	inline Vec Div255(Vec x) { return Shr16By8(Add16(x, Shr16By8(Add16(x, Splat16(257))))); }
+
+	// Returns 'rgb' with the alpha bytes taken from 'a'
+	inline Vec KeepAlpha(Vec rgb, Vec a) { const Vec am = Splat32(ALPHA_BITS); return Or(AndNot(am, rgb), And(am, a)); }
+
+	inline Vec BlendHalf(Vec d, Vec s)
+	{
+		Vec a = AlphaLanes(s);
+		return Add16(Div255(Mul16(s, a)), Div255(Mul16(d, Sub16(Splat16(255), a))));
+	}
+
+	inline Vec AddHalf(Vec d, Vec s) { return Add16(d, Div255(Mul16(s, AlphaLanes(s)))); }
+
+	inline Vec BlendPremultipliedHalf(Vec d, Vec s) { return Add16(s, Div255(Mul16(d, Sub16(Splat16(255), AlphaLanes(s))))); }
+
+	inline Vec PremultiplyHalf(Vec s) { return Div255(Mul16(s, AlphaLanes(s))); }
+
+	// Spreads the alpha byte of each pixel over all 4 bytes of that pixel
+	inline Vec AlphaBytes(Vec s)
+	{
+		Vec a = And(s, Splat32(ALPHA_BITS));
+		a = Or(a, Shr32By8(a));
+		return Or(a, Shr32By16(a));
+	}
+
+	struct BlendKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			Vec r = Pack(BlendHalf(UnpackLo(d), UnpackLo(s)), BlendHalf(UnpackHi(d), UnpackHi(s)));
+			return KeepAlpha(r, d);
+		}
+		inline void operator()(Color& d, Color s) const { d.Blend(s); }
+	};
+
+	struct AddKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			// Pack saturates at 255, which is the clamp in Color::Add
+			Vec r = Pack(AddHalf(UnpackLo(d), UnpackLo(s)), AddHalf(UnpackHi(d), UnpackHi(s)));
+			return KeepAlpha(r, d);
+		}
+		inline void operator()(Color& d, Color s) const { d.Add(s); }
+	};
+
+	struct MaskKernel
+	{
+		// Note that for the alpha byte (s.a & s.a) | (d.a & ~s.a) equals d.a | s.a
+		inline Vec operator()(Vec d, Vec s) const { Vec m = AlphaBytes(s); return Or(And(m, s), AndNot(m, d)); }
+		inline void operator()(Color& d, Color s) const { d.Mask(s); }
+	};
+
+	struct BlendPremultipliedKernel
+	{
+		// Pack saturates at 255, which is the clamp in Color::BlendPremultiplied
+		inline Vec operator()(Vec d, Vec s) const { return Pack(BlendPremultipliedHalf(UnpackLo(d), UnpackLo(s)), BlendPremultipliedHalf(UnpackHi(d), UnpackHi(s))); }
+		inline void operator()(Color& d, Color s) const { d.BlendPremultiplied(s); }
+	};
+
+	struct AddPremultipliedKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const { return AddSat8(d, s); }
+		inline void operator()(Color& d, Color s) const { d.AddPremultiplied(s); }
+	};
+
+	struct PremultiplyKernel
+	{
+		inline Vec operator()(Vec s) const { return KeepAlpha(Pack(PremultiplyHalf(UnpackLo(s)), PremultiplyHalf(UnpackHi(s))), s); }
+		inline void operator()(Color& d, Color s) const { d = s; d.Premultiply(); }
+	};
+
+	struct ModulateKernel
+	{
+		Color mod;
+		Vec mod16;
+		ModulateKernel(Color m) : mod(m), mod16(UnpackLo(Broadcast(m))) {}
+		inline Vec operator()(Vec s) const { return Pack(Div255(Mul16(UnpackLo(s), mod16)), Div255(Mul16(UnpackHi(s), mod16))); }
+		inline void operator()(Color& d, Color s) const { d = s; d.ModulateRGBA(mod); }
+	};
+
+	inline Vec Mul255(Vec a, Vec b) { return Div255(Mul16(a, b)); }
+	inline Vec Select(Vec mask, Vec a, Vec b) { return Or(And(mask, a), AndNot(mask, b)); }
+
+	// The blend mode of straight colors, before it is blended by the source alpha (see Color::ApplyMode)
+	template<typename Mode> Vec ModeStraight(Vec d, Vec s);
+	template<> inline Vec ModeStraight<MultiplyMode>(Vec d, Vec s) { return Mul255(d, s); }
+	template<> inline Vec ModeStraight<ScreenMode>(Vec d, Vec s) { return Sub16(Add16(d, s), Mul255(d, s)); }
+	template<> inline Vec ModeStraight<DarkenMode>(Vec d, Vec s) { return Min16(d, s); }
+	template<> inline Vec ModeStraight<LightenMode>(Vec d, Vec s) { return Max16(d, s); }
+	template<> inline Vec ModeStraight<DifferenceMode>(Vec d, Vec s) { return Sub16(Max16(d, s), Min16(d, s)); }
+
+	template<> inline Vec ModeStraight<OverlayMode>(Vec d, Vec s)
+	{
+		Vec k = Splat16(255);
+		Vec lo = Mul255(d, s);
+		Vec hi = Mul255(Sub16(k, d), Sub16(k, s));
+		return Select(CmpGt16(d, Splat16(127)), Sub16(k, Add16(hi, hi)), Add16(lo, lo));
+	}
+
+	// The part of a blend mode where premultiplied colors overlap (see Color::ApplyModePremultiplied)
+	template<typename Mode> Vec ModePremultiplied(Vec d, Vec s, Vec da, Vec sa);
+	template<> inline Vec ModePremultiplied<MultiplyMode>(Vec d, Vec s, Vec, Vec) { return Mul255(s, d); }
+	template<> inline Vec ModePremultiplied<ScreenMode>(Vec d, Vec s, Vec da, Vec sa) { return Sub16(Add16(Mul255(s, da), Mul255(d, sa)), Mul255(s, d)); }
+	template<> inline Vec ModePremultiplied<DarkenMode>(Vec d, Vec s, Vec da, Vec sa) { return Min16(Mul255(s, da), Mul255(d, sa)); }
+	template<> inline Vec ModePremultiplied<LightenMode>(Vec d, Vec s, Vec da, Vec sa) { return Max16(Mul255(s, da), Mul255(d, sa)); }
+
+	template<> inline Vec ModePremultiplied<OverlayMode>(Vec d, Vec s, Vec da, Vec sa)
+	{
+		Vec lo = Mul255(s, d);
+		Vec hi = Mul255(SubSat16(da, d), SubSat16(sa, s));
+		return Select(CmpGt16(Add16(d, d), da), Sub16(Mul255(sa, da), Add16(hi, hi)), Add16(lo, lo));
+	}
+
+	template<> inline Vec ModePremultiplied<DifferenceMode>(Vec d, Vec s, Vec da, Vec sa)
+	{
+		Vec sd = Mul255(s, da);
+		Vec ds = Mul255(d, sa);
+		return Sub16(Max16(sd, ds), Min16(sd, ds));
+	}
+
+	template<typename Mode>
+	struct ModeKernel
+	{
+		static inline Vec Half(Vec d, Vec s)
+		{
+			Vec a = AlphaLanes(s);
+			return Add16(Mul255(ModeStraight<Mode>(d, s), a), Mul255(d, Sub16(Splat16(255), a)));
+		}
+		inline Vec operator()(Vec d, Vec s) const { return KeepAlpha(Pack(Half(UnpackLo(d), UnpackLo(s)), Half(UnpackHi(d), UnpackHi(s))), d); }
+		inline void operator()(Color& d, Color s) const { Mode::Straight(d, s); }
+	};
+
+	template<typename Mode>
+	struct ModePremultipliedKernel
+	{
+		static inline Vec Half(Vec d, Vec s)
+		{
+			Vec k = Splat16(255);
+			Vec da = AlphaLanes(d);
+			Vec sa = AlphaLanes(s);
+			return Add16(Add16(Mul255(s, Sub16(k, da)), Mul255(d, Sub16(k, sa))), ModePremultiplied<Mode>(d, s, da, sa));
+		}
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			// Pack clamps the colors to 0-255 like the scalar clamp, the alpha is composited like BlendPremultiplied
+			Vec dlo = UnpackLo(d), dhi = UnpackHi(d), slo = UnpackLo(s), shi = UnpackHi(s);
+			Vec r = Pack(Half(dlo, slo), Half(dhi, shi));
+			return KeepAlpha(r, Pack(BlendPremultipliedHalf(dlo, slo), BlendPremultipliedHalf(dhi, shi)));
+		}
+		inline void operator()(Color& d, Color s) const { Mode::Premultiplied(d, s); }
+	};
+
+#elif defined(COLORSPAN_NEON)
+
+	typedef uint8x8x4_t Vec;
+	constexpr int VEC_PIXELS = 8;
+
+	inline Vec Load(const Color* p) { return vld4_u8(reinterpret_cast<const uint8_t*>(p)); }
+	inline void Store(Color* p, Vec v) { vst4_u8(reinterpret_cast<uint8_t*>(p), v); }
+
+	inline Vec Broadcast(Color c)
+	{
+		Vec v;
+		v.val[0] = vdup_n_u8(c.r);
+		v.val[1] = vdup_n_u8(c.g);
+		v.val[2] = vdup_n_u8(c.b);
+		v.val[3] = vdup_n_u8(c.a);
+		return v;
+	}
+
+	// Same as DIV_255_FAST, for 16-bit lanes. Products of two bytes never overflow the lanes.
+	inline uint16x8_t Div255(uint16x8_t x) { return vshrq_n_u16(vaddq_u16(x, vshrq_n_u16(vaddq_u16(x, vdupq_n_u16(257)), 8)), 8); }
+
+	struct BlendKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			uint8x8_t ia = vmvn_u8(s.val[3]);
+			for(int c = 0; c < 3; c++)
+				d.val[c] = vmovn_u16(vaddq_u16(Div255(vmull_u8(s.val[c], s.val[3])), Div255(vmull_u8(d.val[c], ia))));
+			return d;
+		}
+		inline void operator()(Color& d, Color s) const { d.Blend(s); }
+	};
+
+	struct AddKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			for(int c = 0; c < 3; c++)
+				d.val[c] = vqmovn_u16(vaddw_u8(Div255(vmull_u8(s.val[c], s.val[3])), d.val[c]));
+			return d;
+		}
+		inline void operator()(Color& d, Color s) const { d.Add(s); }
+	};
+
+	struct MaskKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			for(int c = 0; c < 3; c++)
+				d.val[c] = vbsl_u8(s.val[3], s.val[c], d.val[c]);
+			d.val[3] = vorr_u8(d.val[3], s.val[3]);
+			return d;
+		}
+		inline void operator()(Color& d, Color s) const { d.Mask(s); }
+	};
+
+	struct BlendPremultipliedKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			uint8x8_t ia = vmvn_u8(s.val[3]);
+			for(int c = 0; c < 4; c++)
+				d.val[c] = vqmovn_u16(vaddw_u8(Div255(vmull_u8(d.val[c], ia)), s.val[c]));
+			return d;
+		}
+		inline void operator()(Color& d, Color s) const { d.BlendPremultiplied(s); }
+	};
+
+	struct AddPremultipliedKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			for(int c = 0; c < 4; c++)
+				d.val[c] = vqadd_u8(d.val[c], s.val[c]);
+			return d;
+		}
+		inline void operator()(Color& d, Color s) const { d.AddPremultiplied(s); }
+	};
+
+	struct PremultiplyKernel
+	{
+		inline Vec operator()(Vec s) const
+		{
+			for(int c = 0; c < 3; c++)
+				s.val[c] = vmovn_u16(Div255(vmull_u8(s.val[c], s.val[3])));
+			return s;
+		}
+		inline void operator()(Color& d, Color s) const { d = s; d.Premultiply(); }
+	};
+
+	struct ModulateKernel
+	{
+		Color mod;
+		Vec modv;
+		ModulateKernel(Color m) : mod(m), modv(Broadcast(m)) {}
+		inline Vec operator()(Vec s) const
+		{
+			for(int c = 0; c < 4; c++)
+				s.val[c] = vmovn_u16(Div255(vmull_u8(s.val[c], modv.val[c])));
+			return s;
+		}
+		inline void operator()(Color& d, Color s) const { d = s; d.ModulateRGBA(mod); }
+	};
+
+	inline int16x8_t Mul255(uint8x8_t a, uint8x8_t b) { return vreinterpretq_s16_u16(Div255(vmull_u8(a, b))); }
+	inline int16x8_t Widen(uint8x8_t v) { return vreinterpretq_s16_u16(vmovl_u8(v)); }
+
+	// The blend mode of straight colors, before it is blended by the source alpha (see Color::ApplyMode)
+	template<typename Mode> int16x8_t ModeStraight(uint8x8_t d, uint8x8_t s);
+	template<> inline int16x8_t ModeStraight<MultiplyMode>(uint8x8_t d, uint8x8_t s) { return Mul255(d, s); }
+	template<> inline int16x8_t ModeStraight<ScreenMode>(uint8x8_t d, uint8x8_t s) { return vsubq_s16(vreinterpretq_s16_u16(vaddl_u8(d, s)), Mul255(d, s)); }
+	template<> inline int16x8_t ModeStraight<DarkenMode>(uint8x8_t d, uint8x8_t s) { return Widen(vmin_u8(d, s)); }
+	template<> inline int16x8_t ModeStraight<LightenMode>(uint8x8_t d, uint8x8_t s) { return Widen(vmax_u8(d, s)); }
+	template<> inline int16x8_t ModeStraight<DifferenceMode>(uint8x8_t d, uint8x8_t s) { return Widen(vabd_u8(d, s)); }
+
+	template<> inline int16x8_t ModeStraight<OverlayMode>(uint8x8_t d, uint8x8_t s)
+	{
+		int16x8_t lo = Mul255(d, s);
+		int16x8_t hi = Mul255(vmvn_u8(d), vmvn_u8(s));
+		return vbslq_s16(vcgtq_u16(vmovl_u8(d), vdupq_n_u16(127)), vsubq_s16(vdupq_n_s16(255), vaddq_s16(hi, hi)), vaddq_s16(lo, lo));
+	}
+
+	// The part of a blend mode where premultiplied colors overlap (see Color::ApplyModePremultiplied)
+	template<typename Mode> int16x8_t ModePremultiplied(uint8x8_t d, uint8x8_t s, uint8x8_t da, uint8x8_t sa);
+	template<> inline int16x8_t ModePremultiplied<MultiplyMode>(uint8x8_t d, uint8x8_t s, uint8x8_t, uint8x8_t) { return Mul255(s, d); }
+	template<> inline int16x8_t ModePremultiplied<ScreenMode>(uint8x8_t d, uint8x8_t s, uint8x8_t da, uint8x8_t sa) { return vsubq_s16(vaddq_s16(Mul255(s, da), Mul255(d, sa)), Mul255(s, d)); }
+	template<> inline int16x8_t ModePremultiplied<DarkenMode>(uint8x8_t d, uint8x8_t s, uint8x8_t da, uint8x8_t sa) { return vminq_s16(Mul255(s, da), Mul255(d, sa)); }
+	template<> inline int16x8_t ModePremultiplied<LightenMode>(uint8x8_t d, uint8x8_t s, uint8x8_t da, uint8x8_t sa) { return vmaxq_s16(Mul255(s, da), Mul255(d, sa)); }
+	template<> inline int16x8_t ModePremultiplied<DifferenceMode>(uint8x8_t d, uint8x8_t s, uint8x8_t da, uint8x8_t sa) { return vabdq_s16(Mul255(s, da), Mul255(d, sa)); }
+
+	template<> inline int16x8_t ModePremultiplied<OverlayMode>(uint8x8_t d, uint8x8_t s, uint8x8_t da, uint8x8_t sa)
+	{
+		int16x8_t lo = Mul255(s, d);
+		int16x8_t hi = Mul255(vqsub_u8(da, d), vqsub_u8(sa, s));
+		return vbslq_s16(vcgtq_u16(vshll_n_u8(d, 1), vmovl_u8(da)), vsubq_s16(Mul255(sa, da), vaddq_s16(hi, hi)), vaddq_s16(lo, lo));
+	}
+
+	template<typename Mode>
+	struct ModeKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			uint8x8_t ia = vmvn_u8(s.val[3]);
+			for(int c = 0; c < 3; c++)
+			{
+				uint8x8_t f = vqmovun_s16(ModeStraight<Mode>(d.val[c], s.val[c]));
+				d.val[c] = vmovn_u16(vaddq_u16(Div255(vmull_u8(f, s.val[3])), Div255(vmull_u8(d.val[c], ia))));
+			}
+			return d;
+		}
+		inline void operator()(Color& d, Color s) const { Mode::Straight(d, s); }
+	};
+
+	template<typename Mode>
+	struct ModePremultipliedKernel
+	{
+		inline Vec operator()(Vec d, Vec s) const
+		{
+			uint8x8_t ia = vmvn_u8(s.val[3]);
+			uint8x8_t ida = vmvn_u8(d.val[3]);
+			for(int c = 0; c < 3; c++)
+			{
+				int16x8_t v = vaddq_s16(Mul255(s.val[c], ida), Mul255(d.val[c], ia));
+				d.val[c] = vqmovun_s16(vaddq_s16(v, ModePremultiplied<Mode>(d.val[c], s.val[c], d.val[3], s.val[3])));
+			}
+			d.val[3] = vqmovn_u16(vaddw_u8(Div255(vmull_u8(d.val[3], ia)), s.val[3]));
+			return d;
+		}
+		inline void operator()(Color& d, Color s) const { Mode::Premultiplied(d, s); }
+	};
+
+#else
+
+	struct BlendKernel { inline void operator()(Color& d, Color s) const { d.Blend(s); } };
+	struct AddKernel { inline void operator()(Color& d, Color s) const { d.Add(s); } };
+	struct MaskKernel { inline void operator()(Color& d, Color s) const { d.Mask(s); } };
+	struct BlendPremultipliedKernel { inline void operator()(Color& d, Color s) const { d.BlendPremultiplied(s); } };
+	struct AddPremultipliedKernel { inline void operator()(Color& d, Color s) const { d.AddPremultiplied(s); } };
+	struct PremultiplyKernel { inline void operator()(Color& d, Color s) const { d = s; d.Premultiply(); } };
+
+	struct ModulateKernel
+	{
+		Color mod;
+		ModulateKernel(Color m) : mod(m) {}
+		inline void operator()(Color& d, Color s) const { d = s; d.ModulateRGBA(mod); }
+	};
+
+	template<typename Mode> struct ModeKernel { inline void operator()(Color& d, Color s) const { Mode::Straight(d, s); } };
+	template<typename Mode> struct ModePremultipliedKernel { inline void operator()(Color& d, Color s) const { Mode::Premultiplied(d, s); } };
+
+#endif
+
+	#if defined(COLORSPAN_X86) || defined(COLORSPAN_NEON)
+		#define COLORSPAN_SIMD
+	#endif
+
+	// Applies a kernel which combines source and destination pixels
+	template<typename K>
+	inline void CombineSpan(K kernel, Color* dst, const Color* src, int count)
+	{
+		int i = 0;
+		#ifdef COLORSPAN_SIMD
+			for(; i <= (count - VEC_PIXELS); i += VEC_PIXELS)
+				Store(dst + i, kernel(Load(dst + i), Load(src + i)));
+		#endif
+		for(; i < count; i++)
+			kernel(dst[i], src[i]);
+	}
+
+	// Applies a kernel which combines a single color with the destination pixels
+	template<typename K>
+	inline void CombineSpan(K kernel, Color* dst, Color c, int count)
+	{
+		int i = 0;
+		#ifdef COLORSPAN_SIMD
+			Vec cv = Broadcast(c);
+			for(; i <= (count - VEC_PIXELS); i += VEC_PIXELS)
+				Store(dst + i, kernel(Load(dst + i), cv));
+		#endif
+		for(; i < count; i++)
+			kernel(dst[i], c);
+	}
+
+	// Applies a kernel which transforms the source pixels into the destination pixels
+	template<typename K>
+	inline void TransformSpan(K kernel, Color* dst, const Color* src, int count)
+	{
+		int i = 0;
+		#ifdef COLORSPAN_SIMD
+			for(; i <= (count - VEC_PIXELS); i += VEC_PIXELS)
+				Store(dst + i, kernel(Load(src + i)));
+		#endif
+		for(; i < count; i++)
+			kernel(dst[i], src[i]);
+	}
+}
+
+void FillSpan(Color* dst, Color c, int count) { std::fill_n(dst, count, c); }
+void BlendSpan(Color* dst, const Color* src, int count) { CombineSpan(BlendKernel(), dst, src, count); }
+void BlendSpan(Color* dst, Color c, int count) { CombineSpan(BlendKernel(), dst, c, count); }
+void AddSpan(Color* dst, const Color* src, int count) { CombineSpan(AddKernel(), dst, src, count); }
+void AddSpan(Color* dst, Color c, int count) { CombineSpan(AddKernel(), dst, c, count); }
+void MaskSpan(Color* dst, const Color* src, int count) { CombineSpan(MaskKernel(), dst, src, count); }
+void MaskSpan(Color* dst, Color c, int count) { CombineSpan(MaskKernel(), dst, c, count); }
+void BlendPremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(BlendPremultipliedKernel(), dst, src, count); }
+void BlendPremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(BlendPremultipliedKernel(), dst, c, count); }
+void AddPremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(AddPremultipliedKernel(), dst, src, count); }
+void AddPremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(AddPremultipliedKernel(), dst, c, count); }
+void MultiplySpan(Color* dst, const Color* src, int count) { CombineSpan(ModeKernel<MultiplyMode>(), dst, src, count); }
+void MultiplySpan(Color* dst, Color c, int count) { CombineSpan(ModeKernel<MultiplyMode>(), dst, c, count); }
+void MultiplyPremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(ModePremultipliedKernel<MultiplyMode>(), dst, src, count); }
+void MultiplyPremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(ModePremultipliedKernel<MultiplyMode>(), dst, c, count); }
+void ScreenSpan(Color* dst, const Color* src, int count) { CombineSpan(ModeKernel<ScreenMode>(), dst, src, count); }
+void ScreenSpan(Color* dst, Color c, int count) { CombineSpan(ModeKernel<ScreenMode>(), dst, c, count); }
+void ScreenPremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(ModePremultipliedKernel<ScreenMode>(), dst, src, count); }
+void ScreenPremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(ModePremultipliedKernel<ScreenMode>(), dst, c, count); }
+void OverlaySpan(Color* dst, const Color* src, int count) { CombineSpan(ModeKernel<OverlayMode>(), dst, src, count); }
+void OverlaySpan(Color* dst, Color c, int count) { CombineSpan(ModeKernel<OverlayMode>(), dst, c, count); }
+void OverlayPremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(ModePremultipliedKernel<OverlayMode>(), dst, src, count); }
+void OverlayPremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(ModePremultipliedKernel<OverlayMode>(), dst, c, count); }
+void DarkenSpan(Color* dst, const Color* src, int count) { CombineSpan(ModeKernel<DarkenMode>(), dst, src, count); }
+void DarkenSpan(Color* dst, Color c, int count) { CombineSpan(ModeKernel<DarkenMode>(), dst, c, count); }
+void DarkenPremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(ModePremultipliedKernel<DarkenMode>(), dst, src, count); }
+void DarkenPremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(ModePremultipliedKernel<DarkenMode>(), dst, c, count); }
+void LightenSpan(Color* dst, const Color* src, int count) { CombineSpan(ModeKernel<LightenMode>(), dst, src, count); }
+void LightenSpan(Color* dst, Color c, int count) { CombineSpan(ModeKernel<LightenMode>(), dst, c, count); }
+void LightenPremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(ModePremultipliedKernel<LightenMode>(), dst, src, count); }
+void LightenPremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(ModePremultipliedKernel<LightenMode>(), dst, c, count); }
+void DifferenceSpan(Color* dst, const Color* src, int count) { CombineSpan(ModeKernel<DifferenceMode>(), dst, src, count); }
+void DifferenceSpan(Color* dst, Color c, int count) { CombineSpan(ModeKernel<DifferenceMode>(), dst, c, count); }
+void DifferencePremultipliedSpan(Color* dst, const Color* src, int count) { CombineSpan(ModePremultipliedKernel<DifferenceMode>(), dst, src, count); }
+void DifferencePremultipliedSpan(Color* dst, Color c, int count) { CombineSpan(ModePremultipliedKernel<DifferenceMode>(), dst, c, count); }
+void PremultiplySpan(Color* dst, const Color* src, int count) { TransformSpan(PremultiplyKernel(), dst, src, count); }
+
+void UnpremultiplySpan(Color* dst, const Color* src, int count)
+{
+	// This divides, but it is only needed when premultiplied images are drawn on a straight canvas
+	for(int i = 0; i < count; i++)
+	{
+		dst[i] = src[i];
+		dst[i].Unpremultiply();
+	}
+}
+
+void ModulateSpan(Color* dst, const Color* src, Color mod, int count) { TransformSpan(ModulateKernel(mod), dst, src, count); }
+
+void ModulateSpan(Color* dst, const Color* src, byte m, int count)
+{
+	ModulateSpan(dst, src, Color(m, m, m, m), count);
+}
+
+void LookupSpan(Color* dst, const byte* indices, const Color* palette, int count)
+{
+	int i = 0;
+	#if defined(__AVX2__)
+		// Gathers 8 palette colors at once, the indices are widened to 32-bit offsets
+		const int* table = reinterpret_cast<const int*>(palette);
+		for(; i <= (count - 8); i += 8)
+		{
+			__m256i offsets = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)));
+			Store(dst + i, _mm256_i32gather_epi32(table, offsets, 4));
+		}
+	#endif
+	for(; i < count; i++)
+		dst[i] = palette[indices[i]];
+}
+
+void HalveSpan(Color* dst, const Color* row0, const Color* row1, int count)
+{
+	int i = 0;
+	#if defined(COLORSPAN_X86)
+		// 4 pixels at once. The rows are added in 16-bit lanes, then the 64-bit halves with the
+		// left and right pixel of every pair.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		for(; i <= (count - 4); i += 4)
+		{
+			__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * i));
+			__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * i + 4));
+			__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * i));
+			__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * i + 4));
+			__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+			__m128i t0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+			__m128i t1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+			t0 = _mm_srli_epi16(_mm_add_epi16(t0, two), 2);
+			t1 = _mm_srli_epi16(_mm_add_epi16(t1, two), 2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(t0, t1));
+		}
+	#elif defined(COLORSPAN_NEON)
+		// 8 pixels at once, the channel planes add their neighboring pixels pairwise
+		for(; i <= (count - 8); i += 8)
+		{
+			uint8x16x4_t a = vld4q_u8(reinterpret_cast<const uint8_t*>(row0 + 2 * i));
+			uint8x16x4_t b = vld4q_u8(reinterpret_cast<const uint8_t*>(row1 + 2 * i));
+			uint8x8x4_t out;
+			for(int c = 0; c < 4; c++)
+				out.val[c] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(a.val[c]), vpaddlq_u8(b.val[c])), 2);
+			vst4_u8(reinterpret_cast<uint8_t*>(dst + i), out);
+		}
+	#endif
+	for(; i < count; i++)
+	{
+		const Color* a = row0 + 2 * i;
+		const Color* b = row1 + 2 * i;
+		dst[i] = Color(
+			static_cast<byte>((a[0].r + a[1].r + b[0].r + b[1].r + 2) >> 2),
+			static_cast<byte>((a[0].g + a[1].g + b[0].g + b[1].g + 2) >> 2),
+			static_cast<byte>((a[0].b + a[1].b + b[0].b + b[1].b + 2) >> 2),
+			static_cast<byte>((a[0].a + a[1].a + b[0].a + b[1].a + 2) >> 2));
+	}
+}
+
+void HalveSpan(byte* dst, const byte* row0, const byte* row1, int count)
+{
+	int i = 0;
+	#if defined(COLORSPAN_X86)
+		// 16 pixels at once, the even and odd source pixels are split into 16-bit lanes
+		const __m128i low = _mm_set1_epi16(0x00FF);
+		const __m128i two = _mm_set1_epi16(2);
+		for(; i <= (count - 16); i += 16)
+		{
+			__m128i out[2];
+			for(int h = 0; h < 2; h++)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * i + 16 * h));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * i + 16 * h));
+				__m128i sa = _mm_add_epi16(_mm_and_si128(a, low), _mm_srli_epi16(a, 8));
+				__m128i sb = _mm_add_epi16(_mm_and_si128(b, low), _mm_srli_epi16(b, 8));
+				out[h] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sa, sb), two), 2);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(out[0], out[1]));
+		}
+	#elif defined(COLORSPAN_NEON)
+		for(; i <= (count - 8); i += 8)
+		{
+			uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(row0 + 2 * i)), vpaddlq_u8(vld1q_u8(row1 + 2 * i)));
+			vst1_u8(dst + i, vrshrn_n_u16(sum, 2));
+		}
+	#endif
+	for(; i < count; i++)
+		dst[i] = static_cast<byte>((row0[2 * i] + row0[2 * i + 1] + row1[2 * i] + row1[2 * i + 1] + 2) >> 2);
+}
+
+// Converts a value from 0 to 1 to a byte, rounded to nearest. Not-a-number fails both compares.
+static inline byte PlaneByte(float v)
+{
+	v = v * 255.0f + 0.5f;
+	v = (v > 0.0f) ? v : 0.0f;
+	v = (v < 255.0f) ? v : 255.0f;
+	return static_cast<byte>(v);
+}
+
+void InterleaveSpan(Color* dst, const float* r, const float* g, const float* b, const float* a, int count)
+{
+	// The channels are converted to 32-bit integers which are at most 255, so the pixels are
+	// the channels shifted into their bytes and combined, without shuffles
+	int i = 0;
+	#if defined(__AVX2__)
+		const __m256 scale = _mm256_set1_ps(255.0f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		auto convert = [&](const float* plane)
+		{
+			__m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(plane), scale), half);
+			return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(v, zero), scale));
+		};
+		for(; i <= (count - 8); i += 8)
+		{
+			__m256i p = _mm256_or_si256(convert(r + i), _mm256_slli_epi32(convert(g + i), 8));
+			p = _mm256_or_si256(p, _mm256_slli_epi32(convert(b + i), 16));
+			p = _mm256_or_si256(p, _mm256_slli_epi32(convert(a + i), 24));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), p);
+		}
+	#elif defined(__SSE2__)
+		const __m128 scale = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		auto convert = [&](const float* plane)
+		{
+			__m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(plane), scale), half);
+			return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, zero), scale));
+		};
+		for(; i <= (count - 4); i += 4)
+		{
+			__m128i p = _mm_or_si128(convert(r + i), _mm_slli_epi32(convert(g + i), 8));
+			p = _mm_or_si128(p, _mm_slli_epi32(convert(b + i), 16));
+			p = _mm_or_si128(p, _mm_slli_epi32(convert(a + i), 24));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), p);
+		}
+	#elif defined(COLORSPAN_NEON)
+		// The conversion to unsigned integers makes negative values and not-a-number 0
+		const float32x4_t scale = vdupq_n_f32(255.0f);
+		const float32x4_t half = vdupq_n_f32(0.5f);
+		auto convert = [&](const float* plane)
+		{
+			return vcvtq_u32_f32(vminq_f32(vmlaq_f32(half, vld1q_f32(plane), scale), scale));
+		};
+		for(; i <= (count - 4); i += 4)
+		{
+			uint32x4_t p = vorrq_u32(convert(r + i), vshlq_n_u32(convert(g + i), 8));
+			p = vorrq_u32(p, vshlq_n_u32(convert(b + i), 16));
+			p = vorrq_u32(p, vshlq_n_u32(convert(a + i), 24));
+			vst1q_u32(reinterpret_cast<uint32_t*>(dst + i), p);
+		}
+	#endif
+	for(; i < count; i++)
+		dst[i] = Color(PlaneByte(r[i]), PlaneByte(g[i]), PlaneByte(b[i]), PlaneByte(a[i]));
+}
+
+uint32_t HashSpan(const Color* src, int count)
+{
+	// Pixels are 4 bytes, so the data is a number of 8 byte words and at most one 4 byte word.
+	// The CRC of the bytes is the same whether they are taken 8 or 4 at a time, so 32-bit x86,
+	// which has no 8 byte CRC instruction, takes all of them 4 at a time.
+	const byte* data = reinterpret_cast<const byte*>(src);
+	size_t size = static_cast<size_t>(count) * sizeof(Color);
+	size_t i = 0;
+	#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+		uint64_t crc = 0xFFFFFFFFu;
+		#if !defined(__SSE4_2__) || defined(__x86_64__)
+			for(; (i + 8) <= size; i += 8)
+			{
+				uint64_t v;
+				memcpy(&v, data + i, 8);
+				#if defined(__SSE4_2__)
+					crc = _mm_crc32_u64(crc, v);
+				#else
+					crc = __crc32cd(static_cast<uint32_t>(crc), v);
+				#endif
+			}
+		#endif
+		for(; (i + 4) <= size; i += 4)
+		{
+			uint32_t v;
+			memcpy(&v, data + i, 4);
+			#if defined(__SSE4_2__)
+				crc = _mm_crc32_u32(static_cast<uint32_t>(crc), v);
+			#else
+				crc = __crc32cw(static_cast<uint32_t>(crc), v);
+			#endif
+		}
+		return ~static_cast<uint32_t>(crc);
+	#else
+		uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+		for(; (i + 8) <= size; i += 8)
+		{
+			uint64_t v;
+			memcpy(&v, data + i, 8);
+			h = (h ^ v) * 0xFF51AFD7ED558CCDull;
+			h ^= h >> 32;
+		}
+		if(i < size)
+		{
+			uint32_t v;
+			memcpy(&v, data + i, 4);
+			h = (h ^ v) * 0xFF51AFD7ED558CCDull;
+		}
+		h ^= h >> 29;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		return static_cast<uint32_t>(h ^ (h >> 32));
+	#endif
+}
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "core/Convolution.h"
+
+// Boxes up to this size divide exactly with the reciprocal (see Divide)
+static constexpr int MAX_BOX_SIZE = 4095;
+
+// Returns the reciprocal of the divisor for Divide
+static inline uint64_t Reciprocal(int divisor)
+{
+	return ((1ull << 32) + divisor - 1) / divisor;
+}
+
+// Returns the sum divided by the divisor (of which the reciprocal is given), rounded to nearest.
+// Multiplying by the rounded up reciprocal is exact while the sum is less than 256 times the
+// divisor and the divisor is at most MAX_BOX_SIZE.
+static inline byte Divide(int sum, uint64_t reciprocal, int half)
+{
+	return static_cast<byte>((static_cast<uint64_t>(sum + half) * reciprocal) >> 32);
+}
+
+// Returns a weighted sum divided by the divisor, rounded to nearest and limited to 0 to 255
+static inline byte DivideClamped(int sum, int divisor)
+{
+	if(sum <= 0)
+		return 0;
+	return static_cast<byte>(std::min((sum + divisor / 2) / divisor, 255));
+}
+
+// Copies the row to the line with radius copies of the edge pixels on both sides, and one more
+// on the right so that the running sums may read one pixel past the window
+static void PadRow(byte* line, const byte* row, int width, int radius, int channels)
+{
+	const byte* last = row + (width - 1) * channels;
+	for(int i = 0; i < radius; i++)
+		std::memcpy(line + i * channels, row, channels);
+	std::memcpy(line + radius * channels, row, width * channels);
+	for(int i = radius + width; i <= 2 * radius + width; i++)
+		std::memcpy(line + i * channels, last, channels);
+}
+
+// Copies the rows of the area to the buffer, without gaps between the rows
+static void CopyArea(PixelBuffer<byte>& buffer, const byte* data, int width, int height, int stride, int channels)
+{
+	int rowbytes = width * channels;
+	buffer.resize(static_cast<size_t>(rowbytes) * height);
+	for(int y = 0; y < height; y++)
+		std::memcpy(&buffer[y * rowbytes], data + y * stride, rowbytes);
+}
+
+// Limits the color channels to alpha, after a kernel which may have made them larger
+static void LimitToAlpha(byte* data, int width, int height, int stride)
+{
+	for(int y = 0; y < height; y++)
+	{
+		Color* row = reinterpret_cast<Color*>(data + y * stride);
+		for(int x = 0; x < width; x++)
+		{
+			row[x].r = std::min(row[x].r, row[x].a);
+			row[x].g = std::min(row[x].g, row[x].a);
+			row[x].b = std::min(row[x].b, row[x].a);
+		}
+	}
+}
+
+// Box blurs a row from the padded line. The sums of the window move along the line, adding the
+// pixel that enters on the right and subtracting the pixel that leaves on the left.
+template<int CHANNELS> static void BoxRow(byte* row, const byte* line, int width, int radius)
+{
+	int size = 2 * radius + 1;
+	uint64_t reciprocal = Reciprocal(size);
+	int half = size / 2;
+	int sum[CHANNELS] = { };
+	for(int i = 0; i < size; i++)
+		for(int c = 0; c < CHANNELS; c++)
+			sum[c] += line[i * CHANNELS + c];
+	for(int x = 0; x < width; x++)
+	{
+		for(int c = 0; c < CHANNELS; c++)
+		{
+			row[x * CHANNELS + c] = Divide(sum[c], reciprocal, half);
+			sum[c] += line[(x + size) * CHANNELS + c] - line[x * CHANNELS + c];
+		}
+	}
+}
+
+Convolution::Area Convolution::GetArea(Canvas& canvas)
+{
+	Area area;
+	area.data = reinterpret_cast<byte*>(&canvas.pixels[canvas.cliptop * canvas.stride + canvas.clipleft]);
+	area.width = canvas.clipright - canvas.clipleft + 1;
+	area.height = canvas.clipbottom - canvas.cliptop + 1;
+	area.stride = canvas.stride * static_cast<int>(sizeof(Color));
+	area.channels = 4;
+	area.premultiplied = canvas.IsPremultiplied();
+	return area;
+}
+
+Convolution::Area Convolution::GetArea(Image& img)
+{
+	Area area;
+	area.data = img.data;
+	area.width = img.width;
+	area.height = img.height;
+	area.channels = img.hascolors ? 4 : 1;
+	area.stride = img.width * area.channels;
+	area.premultiplied = img.premultiplied;
+	return area;
+}
+
+template<typename F> void Convolution::Filter(Canvas& canvas, F f)
+{
+	if(canvas.IsClipEmpty())
+		return;
+	f(GetArea(canvas));
+	canvas.AddDamage(canvas.clipleft, canvas.cliptop, canvas.clipright, canvas.clipbottom);
+}
+
+template<typename F> void Convolution::Filter(Image& img, F f)
+{
+	if((img.Width() > 0) && (img.Height() > 0))
+		f(GetArea(img));
+}
+
+void Convolution::BoxRows(const Area& area, int radius)
+{
+	line.resize(static_cast<size_t>(area.width + 2 * radius + 1) * area.channels);
+	for(int y = 0; y < area.height; y++)
+	{
+		byte* row = area.data + y * area.stride;
+		PadRow(line.data(), row, area.width, radius, area.channels);
+		if(area.channels == 4)
+			BoxRow<4>(row, line.data(), area.width, radius);
+		else
+			BoxRow<1>(row, line.data(), area.width, radius);
+	}
+}
+
+void Convolution::BoxColumns(const Area& area, int radius)
+{
+	// The sums of the window move down the columns, adding the row that enters below and
+	// subtracting the row that leaves above. This works on whole rows, so the inner loops
+	// handle all channels of all pixels alike.
+	int rowbytes = area.width * area.channels;
+	CopyArea(copy, area.data, area.width, area.height, area.stride, area.channels);
+	auto source = [&](int y) { return &copy[std::clamp(y, 0, area.height - 1) * rowbytes]; };
+
+	int size = 2 * radius + 1;
+	uint64_t reciprocal = Reciprocal(size);
+	int half = size / 2;
+	sums.assign(rowbytes, 0);
+	for(int y = -radius; y <= radius; y++)
+	{
+		const byte* src = source(y);
+		for(int i = 0; i < rowbytes; i++)
+			sums[i] += src[i];
+	}
+	for(int y = 0; y < area.height; y++)
+	{
+		byte* dst = area.data + y * area.stride;
+		const byte* enter = source(y + radius + 1);
+		const byte* leave = source(y - radius);
+		for(int i = 0; i < rowbytes; i++)
+		{
+			dst[i] = Divide(sums[i], reciprocal, half);
+			sums[i] += enter[i] - leave[i];
+		}
+	}
+}
+
+void Convolution::KernelRows(const Area& area, const int* weights, int taps, int divisor)
+{
+	int radius = taps / 2;
+	int rowbytes = area.width * area.channels;
+	line.resize(static_cast<size_t>(area.width + 2 * radius + 1) * area.channels);
+	for(int y = 0; y < area.height; y++)
+	{
+		byte* row = area.data + y * area.stride;
+		PadRow(line.data(), row, area.width, radius, area.channels);
+		for(int i = 0; i < rowbytes; i++)
+		{
+			int sum = 0;
+			for(int k = 0; k < taps; k++)
+				sum += weights[k] * line[i + k * area.channels];
+			row[i] = DivideClamped(sum, divisor);
+		}
+	}
+	if(area.premultiplied && (area.channels == 4))
+		LimitToAlpha(area.data, area.width, area.height, area.stride);
+}
+
+void Convolution::KernelColumns(const Area& area, const int* weights, int taps, int divisor)
+{
+	int radius = taps / 2;
+	int rowbytes = area.width * area.channels;
+	CopyArea(copy, area.data, area.width, area.height, area.stride, area.channels);
+	sums.resize(rowbytes);
+	for(int y = 0; y < area.height; y++)
+	{
+		std::fill(sums.begin(), sums.end(), 0);
+		for(int k = 0; k < taps; k++)
+		{
+			const byte* src = &copy[std::clamp(y + k - radius, 0, area.height - 1) * rowbytes];
+			int weight = weights[k];
+			for(int i = 0; i < rowbytes; i++)
+				sums[i] += weight * src[i];
+		}
+		byte* dst = area.data + y * area.stride;
+		for(int i = 0; i < rowbytes; i++)
+			dst[i] = DivideClamped(sums[i], divisor);
+	}
+	if(area.premultiplied && (area.channels == 4))
+		LimitToAlpha(area.data, area.width, area.height, area.stride);
+}
+
+void Convolution::Box(const Area& area, int radius)
+{
+	REQUIRE((radius >= 0) && (radius <= MAX_BOX_SIZE / 2));
+	if(radius == 0)
+		return;
+	BoxRows(area, radius);
+	BoxColumns(area, radius);
+}
+
+void Convolution::Gaussian(const Area& area, float sigma)
+{
+	if(sigma <= 0.0f)
+		return;
+
+	// Three boxes of odd sizes, of which the first m have the lower size and the others the
+	// next odd size, such that their variances add up to the variance of the Gaussian
+	// (see "Fast Almost-Gaussian Filtering" by Kovesi)
+	float variance = 12.0f * sigma * sigma;
+	int lower = static_cast<int>(std::floor(std::sqrt(variance / 3.0f + 1.0f)));
+	if((lower % 2) == 0)
+		lower--;
+	int upper = lower + 2;
+	int m = static_cast<int>(std::lround((variance - 3.0f * lower * lower - 12.0f * lower - 9.0f) / (-4.0f * lower - 4.0f)));
+	m = std::clamp(m, 0, 3);
+	for(int i = 0; i < 3; i++)
+		Box(area, ((i < m) ? lower : upper) / 2);
+}
+
+void Convolution::Unsharp(const Area& area, int radius, float amount, bool edges)
+{
+	CopyArea(original, area.data, area.width, area.height, area.stride, area.channels);
+	Box(area, radius);
+
+	// Amount in 1/256 for sharpening, the size of the box for edges
+	int size = 2 * radius + 1;
+	int gain = edges ? (size * size) : static_cast<int>(std::lround(amount * 256.0f));
+	int colorchannels = (area.channels == 4) ? 3 : 1;
+	int rowbytes = area.width * area.channels;
+	for(int y = 0; y < area.height; y++)
+	{
+		byte* dst = area.data + y * area.stride;
+		const byte* src = &original[y * rowbytes];
+		for(int x = 0; x < rowbytes; x += area.channels)
+		{
+			int limit = (area.premultiplied && (area.channels == 4)) ? src[x + 3] : 255;
+			for(int c = x; c < x + colorchannels; c++)
+			{
+				int difference = src[c] - dst[c];
+				int v = edges ? (std::abs(difference) * gain) : (src[c] + (difference * gain) / 256);
+				dst[c] = static_cast<byte>(std::clamp(v, 0, limit));
+			}
+			if(area.channels == 4)
+				dst[x + 3] = src[x + 3];
+		}
+	}
+}
+
+void Convolution::BoxBlur(Canvas& canvas, int radius)
+{
+	Filter(canvas, [&](const Area& area) { Box(area, radius); });
+}
+
+void Convolution::BoxBlur(Image& img, int radius)
+{
+	Filter(img, [&](const Area& area) { Box(area, radius); });
+}
+
+void Convolution::GaussianBlur(Canvas& canvas, float sigma)
+{
+	Filter(canvas, [&](const Area& area) { Gaussian(area, sigma); });
+}
+
+void Convolution::GaussianBlur(Image& img, float sigma)
+{
+	Filter(img, [&](const Area& area) { Gaussian(area, sigma); });
+}
+
+void Convolution::ConvolveRows(Canvas& canvas, const std::vector<int>& weights, int divisor)
+{
+	REQUIRE(((weights.size() % 2) == 1) && (divisor > 0));
+	Filter(canvas, [&](const Area& area) { KernelRows(area, weights.data(), static_cast<int>(weights.size()), divisor); });
+}
+
+void Convolution::ConvolveRows(Image& img, const std::vector<int>& weights, int divisor)
+{
+	REQUIRE(((weights.size() % 2) == 1) && (divisor > 0));
+	Filter(img, [&](const Area& area) { KernelRows(area, weights.data(), static_cast<int>(weights.size()), divisor); });
+}
+
+void Convolution::ConvolveColumns(Canvas& canvas, const std::vector<int>& weights, int divisor)
+{
+	REQUIRE(((weights.size() % 2) == 1) && (divisor > 0));
+	Filter(canvas, [&](const Area& area) { KernelColumns(area, weights.data(), static_cast<int>(weights.size()), divisor); });
+}
+
+void Convolution::ConvolveColumns(Image& img, const std::vector<int>& weights, int divisor)
+{
+	REQUIRE(((weights.size() % 2) == 1) && (divisor > 0));
+	Filter(img, [&](const Area& area) { KernelColumns(area, weights.data(), static_cast<int>(weights.size()), divisor); });
+}
+
+void Convolution::Sharpen(Canvas& canvas, float amount, int radius)
+{
+	Filter(canvas, [&](const Area& area) { Unsharp(area, radius, amount, false); });
+}
+
+void Convolution::Sharpen(Image& img, float amount, int radius)
+{
+	Filter(img, [&](const Area& area) { Unsharp(area, radius, amount, false); });
+}
+
+void Convolution::DetectEdges(Canvas& canvas, int radius)
+{
+	Filter(canvas, [&](const Area& area) { Unsharp(area, radius, 0.0f, true); });
+}
+
+void Convolution::DetectEdges(Image& img, int radius)
+{
+	Filter(img, [&](const Area& area) { Unsharp(area, radius, 0.0f, true); });
+}
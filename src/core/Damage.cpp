@@ -0,0 +1,78 @@
+#include "core/Damage.h"
+
+Damage::Damage() :
+	width(0),
+	height(0),
+	top(0),
+	bottom(-1)
+{
+}
+
+void Damage::Resize(int w, int h)
+{
+	width = w;
+	height = h;
+	left.resize(h);
+	right.resize(h);
+	Clear();
+}
+
+void Damage::Clear()
+{
+	std::fill(left.begin(), left.end(), width);
+	std::fill(right.begin(), right.end(), -1);
+	top = height;
+	bottom = -1;
+}
+
+void Damage::AddAll()
+{
+	if((width == 0) || (height == 0))
+		return;
+
+	std::fill(left.begin(), left.end(), 0);
+	std::fill(right.begin(), right.end(), width - 1);
+	top = 0;
+	bottom = height - 1;
+}
+
+void Damage::AddRect(int x1, int y1, int x2, int y2)
+{
+	if((x1 > x2) || (y1 > y2))
+		return;
+
+	for(int y = y1; y <= y2; y++)
+	{
+		left[y] = std::min(left[y], x1);
+		right[y] = std::max(right[y], x2);
+	}
+	top = std::min(top, y1);
+	bottom = std::max(bottom, y2);
+}
+
+void Damage::Add(const Damage& other)
+{
+	REQUIRE((other.width == width) && (other.height == height));
+	for(int y = other.top; y <= other.bottom; y++)
+	{
+		left[y] = std::min(left[y], other.left[y]);
+		right[y] = std::max(right[y], other.right[y]);
+	}
+	top = std::min(top, other.top);
+	bottom = std::max(bottom, other.bottom);
+}
+
+Rect Damage::Bounds() const
+{
+	if(IsEmpty())
+		return Rect();
+
+	int l = width;
+	int r = -1;
+	for(int y = top; y <= bottom; y++)
+	{
+		l = std::min(l, left[y]);
+		r = std::max(r, right[y]);
+	}
+	return Rect(l, top, r - l + 1, bottom - top + 1);
+}
@@ -0,0 +1,110 @@
+#include "core/DrawList.h"
+#include "core/Canvas.h"
+
+bool DrawCommand::IsSameState(const DrawCommand& other) const
+{
+	return IsImageDraw() && (op == other.op) && (img == other.img) && (tex == other.tex) && (rows == other.rows) &&
+		(color == other.color) && (mode == other.mode) && (texoffset.x == other.texoffset.x) && (texoffset.y == other.texoffset.y) &&
+		(clip.x == other.clip.x) && (clip.y == other.clip.y) && (clip.width == other.clip.width) && (clip.height == other.clip.height);
+}
+
+DrawList::DrawList() :
+	commandcount(0)
+{
+}
+
+void DrawList::Clear()
+{
+	batches.clear();
+	commandcount = 0;
+}
+
+void DrawList::Add(const DrawCommand& command)
+{
+	// Determine the area the command draws in
+	int left, top, right, bottom;
+	if(command.IsImageDraw())
+	{
+		left = command.pos.x;
+		top = command.pos.y;
+		right = command.pos.x + command.imgrect.width - 1;
+		bottom = command.pos.y + command.imgrect.height - 1;
+	}
+	else if(command.op == DrawOp::Clear)
+	{
+		left = command.clip.Left();
+		top = command.clip.Top();
+		right = command.clip.Right();
+		bottom = command.clip.Bottom();
+	}
+	else
+	{
+		left = std::min(command.pos.x, command.pos2.x);
+		top = std::min(command.pos.y, command.pos2.y);
+		right = std::max(command.pos.x, command.pos2.x);
+		bottom = std::max(command.pos.y, command.pos2.y);
+	}
+	left = std::max(left, command.clip.Left());
+	top = std::max(top, command.clip.Top());
+	right = std::min(right, command.clip.Right());
+	bottom = std::min(bottom, command.clip.Bottom());
+
+	// Commands that draw nothing are left out
+	if((left > right) || (top > bottom))
+		return;
+	commandcount++;
+
+	// Join the most recent batch with the same state, unless we draw
+	// over something that is drawn between that batch and this command
+	if(command.IsImageDraw())
+	{
+		for(auto b = batches.rbegin(); b != batches.rend(); ++b)
+		{
+			if(b->state.IsSameState(command))
+			{
+				b->items.push_back(BlitItem(command.pos, command.imgrect));
+				b->left = std::min(b->left, left);
+				b->top = std::min(b->top, top);
+				b->right = std::max(b->right, right);
+				b->bottom = std::max(b->bottom, bottom);
+				return;
+			}
+			if((left <= b->right) && (top <= b->bottom) && (right >= b->left) && (bottom >= b->top))
+				break;
+		}
+	}
+
+	Batch batch;
+	batch.state = command;
+	if(command.IsImageDraw())
+		batch.items.push_back(BlitItem(command.pos, command.imgrect));
+	batch.left = left;
+	batch.top = top;
+	batch.right = right;
+	batch.bottom = bottom;
+	batches.push_back(std::move(batch));
+}
+
+void DrawList::Execute(Canvas& canvas) const
+{
+	// The batches are drawn directly, so they can't be recorded again
+	REQUIRE(!canvas.IsRecording());
+
+	for(const Batch& b : batches)
+	{
+		const DrawCommand& c = b.state;
+		canvas.PushClip(c.clip);
+		switch(c.op)
+		{
+			case DrawOp::Clear: canvas.Clear(c.color); break;
+			case DrawOp::Line: canvas.DrawLine(c.pos, c.pos2, c.color); break;
+			case DrawOp::LineBlend: canvas.DrawLineBlend(c.pos, c.pos2, c.color); break;
+			case DrawOp::Rectangle: canvas.DrawRectangle(c.pos, c.pos2, c.color, c.fillcolor, c.mode); break;
+			case DrawOp::FillPolygon: canvas.FillPolygon(c.points, c.color, c.mode); break;
+			case DrawOp::FillEllipse: canvas.FillEllipse(Point((c.pos.x + c.pos2.x) / 2, (c.pos.y + c.pos2.y) / 2), (c.pos2.x - c.pos.x) / 2, (c.pos2.y - c.pos.y) / 2, c.color, c.mode); break;
+			case DrawOp::FillRoundedRectangle: canvas.FillRoundedRectangle(c.pos, c.pos2, c.radius, c.color, c.mode); break;
+			default: canvas.DrawItems(c, b.items.data(), static_cast<int>(b.items.size())); break;
+		}
+		canvas.PopClip();
+	}
+}
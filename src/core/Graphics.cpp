@@ -19,18 +19,44 @@
 
 Graphics::Graphics(const Configuration& cfg, bool showfps) :
 	hal(nullptr),
+	bandrenderer(nullptr),
 	showfps(showfps),
 	nextfpstime(Clock::now() + ch::seconds(10)),
 	framescounted(0),
 	frameindex(0)
 {
-	DISPLAY_WIDTH = cfg.GetInt("Display.Width", 128);
-	DISPLAY_HEIGHT = cfg.GetInt("Display.Height", 32);
-	DISPLAY_PANELS = cfg.GetInt("Display.Panels", 2);
+	#ifdef FIXED_DISPLAY_GEOMETRY
+		// The geometry was fixed at compile time, the configuration can only confirm it
+		if((cfg.GetInt("Display.Width", DISPLAY_WIDTH) != DISPLAY_WIDTH) ||
+		   (cfg.GetInt("Display.Height", DISPLAY_HEIGHT) != DISPLAY_HEIGHT) ||
+		   (cfg.GetInt("Display.Panels", DISPLAY_PANELS) != DISPLAY_PANELS))
+		{
+			std::cerr << "Display configuration ignored, this build has a fixed display geometry of "
+				<< DISPLAY_WIDTH << "x" << DISPLAY_HEIGHT << " on " << DISPLAY_PANELS << " panels" << std::endl;
+		}
+	#else
+		DISPLAY_WIDTH = cfg.GetInt("Display.Width", 128);
+		DISPLAY_HEIGHT = cfg.GetInt("Display.Height", 32);
+		DISPLAY_PANELS = cfg.GetInt("Display.Panels", 2);
+	#endif
+
+	// Optionally back large pixel buffers with huge pages (see PixelAllocator.h)
+	PixelAllocator::SetHugePages(cfg.GetBool("Graphics.HugePages", false));
 
     // Initial resize of the canvas to match the configuration
     canvas.Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
 
+	// Track the damage on the canvas, so that only the changed parts are cleared and presented
+	canvas.TrackDamage(cfg.GetBool("Graphics.TrackDamage", true));
+
+	// Optionally store premultiplied alpha on the canvas for cheaper blending
+	canvas.SetPremultiplied(cfg.GetBool("Graphics.PremultipliedAlpha", false));
+
+	// Optionally render band-safe renderers in horizontal bands on multiple threads
+	int bands = std::clamp(cfg.GetInt("Graphics.RenderBands", 1), 1, DISPLAY_HEIGHT);
+	if(bands > 1)
+		bandrenderer = new BandRenderer(bands);
+
 	recordinterval = ch::microseconds(static_cast<int64_t>(std::roundl(1000000.0 / cfg.GetDouble("Graphics.RecordRate", 30))));
 
 	// Choose the graphics implementation depending on the hardware it was built for.
@@ -50,6 +76,7 @@ Graphics::Graphics(const Configuration& cfg, bool showfps) :
 Graphics::~Graphics()
 {
 	SAFE_DELETE(hal);
+	SAFE_DELETE(bandrenderer);
 }
 
 void Graphics::Record(String path)
@@ -82,16 +109,37 @@ void Graphics::RemoveRenderer(IRenderer* r)
 // This renders the canvas and displays it
 void Graphics::Present(bool clear)
 {
-	// Clear the screen
-	if (clear)
+	// Clear the screen, unless the first renderer draws over all of it anyway
+	if (clear && (renderers.empty() || !renderers[0]->CoversFrame()))
 		canvas.Clear(BLACK);
 
-	// Let the renderers draw their art
-	for(IRenderer* r : renderers)
-		r->Render(canvas);
+	// Let the renderers draw their art. Band-safe renderers that follow each
+	// other are rendered together in bands, when that is enabled.
+	size_t i = 0;
+	while(i < renderers.size())
+	{
+		size_t end = i;
+		if((bandrenderer != nullptr) && !canvas.IsRecording())
+		{
+			while((end < renderers.size()) && renderers[end]->IsBandSafe())
+				end++;
+		}
+
+		if(end > i)
+		{
+			bandrenderer->Render(canvas, &renderers[i], static_cast<int>(end - i));
+			i = end;
+		}
+		else
+		{
+			renderers[i]->Render(canvas);
+			i++;
+		}
+	}
 
 	// Show the canvas on display
 	hal->Present(canvas);
+	canvas.ResetDamage();
 
 	// Measure FPS
 	framescounted++;
@@ -115,9 +163,16 @@ void Graphics::Present(bool clear)
 				nextrecordtime += recordinterval;
 			}
 
-			// Record a frame
-			recordbuffer.clear();
-			lodepng::encode(recordbuffer, reinterpret_cast<const unsigned char*>(canvas.GetBuffer()), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+			// Record a frame. When no row changed since the last recorded frame, the
+			// encoded image of that frame is written again.
+			if(canvas.DiffRows(recordhashes, recordchanges) || recordbuffer.empty())
+			{
+				// The encoder needs the rows packed together and straight alpha
+				recordpixels.resize(static_cast<size_t>(canvas.Width()) * canvas.Height());
+				canvas.ReadPixels(recordpixels.data());
+				recordbuffer.clear();
+				lodepng::encode(recordbuffer, reinterpret_cast<const unsigned char*>(recordpixels.data()), canvas.Width(), canvas.Height());
+			}
 			WriteRecordedFrame();
 			nextrecordtime += recordinterval;
 		}
@@ -1,5 +1,7 @@
 #include <core/GraphicsConstants.h>
 
+#ifndef FIXED_DISPLAY_GEOMETRY
 int DISPLAY_WIDTH = 128;
 int DISPLAY_HEIGHT = 32;
 int DISPLAY_PANELS = 2;
+#endif
@@ -1,19 +1,55 @@
 #include "core/Image.h"
+#include "core/ColorSpan.h"
+#include "core/PixelAllocator.h"
 #include "external/DDS.h"
 #include "stb_image.h"
 #include "utils/Tools.h"
 
+// Writes the image at half the size (rounded down, at least 1 pixel) to dst.
+// Every pixel is the average of 2 x 2 source pixels, an odd last row or a
+// single column is used twice.
+template <typename T>
+static void HalveImage(T *dst, const T *src, int srcwidth, int srcheight) {
+  int w = std::max(srcwidth / 2, 1);
+  int h = std::max(srcheight / 2, 1);
+  for (int y = 0; y < h; y++) {
+    const T *row0 = src + std::min(2 * y, srcheight - 1) * srcwidth;
+    const T *row1 = src + std::min(2 * y + 1, srcheight - 1) * srcwidth;
+    if (srcwidth >= 2) {
+      HalveSpan(dst + y * w, row0, row1, w);
+    } else {
+      T pair0[2] = {row0[0], row0[0]};
+      T pair1[2] = {row1[0], row1[0]};
+      HalveSpan(dst + y * w, pair0, pair1, 1);
+    }
+  }
+}
+
+// Swaps the red and blue channels of the pixels
+static void SwapRedBlue(byte *data, int count) {
+  Color *p = reinterpret_cast<Color *>(data);
+  for (int i = 0; i < count; i++) {
+    std::swap(p->r, p->b);
+    p++;
+  }
+}
+
 // Constructor
-Image::Image() : hascolors(false), width(0), height(0), data(nullptr) {}
+Image::Image()
+    : hascolors(false), premultiplied(false), width(0), height(0),
+      data(nullptr) {}
 
 // Constructor
-Image::Image(const String &filename) : Image() { Load(filename); }
+Image::Image(const String &filename, bool premultiply, bool buildmips)
+    : Image() {
+  Load(filename, premultiply, buildmips);
+}
 
 Image::Image(int w, int h) : Image() {
   width = w;
   height = h;
   hascolors = true;
-  data = (byte *)malloc(w * h * 4);
+  data = (byte *)PixelAllocator::Allocate(w * h * 4);
   if (data) {
     memset(data, 0, w * h * 4);
   }
@@ -22,6 +58,8 @@ Image::Image(int w, int h) : Image() {
 void Image::SetPixel(int x, int y, Color c) {
   if (x < 0 || x >= width || y < 0 || y >= height || !data || !hascolors)
     return;
+  if (premultiplied)
+    c.Premultiply();
   Color *p = reinterpret_cast<Color *>(data);
   p[y * width + x] = c;
 }
@@ -30,14 +68,76 @@ void Image::SetPixel(int x, int y, Color c) {
 Image::~Image() { Unload(); }
 
 void Image::Unload() {
+  PixelAllocator::Free(data, DataSize());
+  data = nullptr;
   width = 0;
   height = 0;
   hascolors = false;
-  SAFE_FREE(data);
+  premultiplied = false;
+  mips.clear();
+}
+
+void Image::Premultiply() {
+  if (!hascolors || premultiplied || !data)
+    return;
+  Color *p = reinterpret_cast<Color *>(data);
+  for (int y = 0; y < height; y++)
+    PremultiplySpan(p + y * width, p + y * width, width);
+  premultiplied = true;
+  for (auto &mip : mips)
+    mip->Premultiply();
+}
+
+void Image::BuildMips() {
+  mips.clear();
+  if (!data)
+    return;
+
+  // Straight colors are averaged with premultiplied alpha, so that transparent
+  // pixels do not bleed their color into the average
+  bool convert = hascolors && !premultiplied;
+  PixelBuffer<Color> prevlevel, level;
+  if (convert) {
+    prevlevel.resize(width * height);
+    PremultiplySpan(prevlevel.data(), ColorData(), width * height);
+  }
+
+  const byte *prev =
+      convert ? reinterpret_cast<const byte *>(prevlevel.data()) : data;
+  int prevwidth = width;
+  int prevheight = height;
+  while ((prevwidth > 1) || (prevheight > 1)) {
+    auto mip = std::make_unique<Image>();
+    mip->hascolors = hascolors;
+    mip->premultiplied = premultiplied;
+    mip->width = std::max(prevwidth / 2, 1);
+    mip->height = std::max(prevheight / 2, 1);
+    int count = mip->width * mip->height;
+    mip->data = (byte *)PixelAllocator::Allocate(mip->DataSize());
+    if (!hascolors) {
+      HalveImage(mip->data, prev, prevwidth, prevheight);
+      prev = mip->data;
+    } else if (convert) {
+      level.resize(count);
+      HalveImage(level.data(), reinterpret_cast<const Color *>(prev),
+                 prevwidth, prevheight);
+      UnpremultiplySpan(reinterpret_cast<Color *>(mip->data), level.data(),
+                        count);
+      std::swap(prevlevel, level);
+      prev = reinterpret_cast<const byte *>(prevlevel.data());
+    } else {
+      HalveImage(reinterpret_cast<Color *>(mip->data),
+                 reinterpret_cast<const Color *>(prev), prevwidth, prevheight);
+      prev = mip->data;
+    }
+    prevwidth = mip->width;
+    prevheight = mip->height;
+    mips.push_back(std::move(mip));
+  }
 }
 
 // Load image from DDS file
-void Image::Load(const String &filename) {
+void Image::Load(const String &filename, bool premultiply, bool buildmips) {
   Unload();
 
   // Check if the file is a DDS file
@@ -51,7 +151,6 @@ void Image::Load(const String &filename) {
     int result = dds_load_from_file(filename, &ddsinfo, SUPPORTED_FORMATS);
     ENSURE(result == DDS_SUCCESS);
     ASSERT(ddsinfo.image.depth <= 1, "Volume images are not supported");
-    ASSERT(ddsinfo.mipcount <= 1, "Mipmaps are not supported");
     ASSERT((ddsinfo.flags & DDS_CUBEMAP_FULL) == 0,
            "Cubemaps are not supported");
 
@@ -59,17 +158,30 @@ void Image::Load(const String &filename) {
     width = ddsinfo.image.width;
     height = ddsinfo.image.height;
     hascolors = (ddsinfo.image.format != DDS_FMT_M8);
-    data = dds_read_all(&ddsinfo);
+    byte *ddsdata = dds_read_all(&ddsinfo);
+    ENSURE(ddsdata != nullptr);
+    data = (byte *)PixelAllocator::Allocate(DataSize());
+    memcpy(data, ddsdata, DataSize());
+
+    // The mip levels follow the image in the data, they become our mip levels
+    for (dds_u32 m = 1; m < ddsinfo.mipcount; m++) {
+      dds_image_info plane;
+      ddsinfo.mip = m;
+      dds_getinfo(&ddsinfo, &plane);
+      auto mip = std::make_unique<Image>();
+      mip->SetData(plane.width, plane.height, hascolors,
+                   ddsdata + ddsinfo.mipoffsets[m]);
+      mips.push_back(std::move(mip));
+    }
+    free(ddsdata);
 
     // Check if we need to swap color components
     if ((ddsinfo.image.format == DDS_FMT_B8G8R8A8) ||
         (ddsinfo.image.format == DDS_FMT_B8G8R8X8)) {
       // Swap red and blue
-      Color *p = reinterpret_cast<Color *>(data);
-      for (int i = 0; i < (width * height); i++) {
-        std::swap(p->r, p->b);
-        p++;
-      }
+      SwapRedBlue(data, width * height);
+      for (auto &mip : mips)
+        SwapRedBlue(mip->data, mip->width * mip->height);
     }
   } else {
     // Try loading with stb_image
@@ -89,16 +201,22 @@ void Image::Load(const String &filename) {
 
     // Deep copy to our own buffer to be safe with allocators
     int size = width * height * 4;
-    data = (byte *)malloc(size);
+    data = (byte *)PixelAllocator::Allocate(size);
     if (data) {
       memcpy(data, stbi_data, size);
     }
 
     stbi_image_free(stbi_data);
   }
+
+  if (premultiply)
+    Premultiply();
+  if (buildmips && mips.empty())
+    BuildMips();
 }
 
-void Image::SetData(int w, int h, bool hasColor, byte *newData) {
+void Image::SetData(int w, int h, bool hasColor, byte *newData,
+                    bool premultiply) {
   Unload();
   width = w;
   height = h;
@@ -106,7 +224,7 @@ void Image::SetData(int w, int h, bool hasColor, byte *newData) {
 
   // Deep copy data
   int size = width * height * (hascolors ? 4 : 1);
-  data = (byte *)malloc(size);
+  data = (byte *)PixelAllocator::Allocate(size);
   if (data && newData) {
     memcpy(data, newData, size);
   }
@@ -116,4 +234,7 @@ void Image::SetData(int w, int h, bool hasColor, byte *newData) {
   // struct padding?) Code says: Color { byte r, g, b, a; } -> RGBA But DDS
   // loader swapped R and B for some formats. Textures on some platforms behave
   // differently. For now assume RGBA is fine or we swap if needed.
+
+  if (premultiply)
+    Premultiply();
 }
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include "core/IndexedCanvas.h"
+
+IndexedCanvas::IndexedCanvas()
+{
+	Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	SetPaletteGradient(0, 255, BLACK, WHITE);
+}
+
+IndexedCanvas::IndexedCanvas(int width, int height)
+{
+	Resize(width, height);
+	SetPaletteGradient(0, 255, BLACK, WHITE);
+}
+
+void IndexedCanvas::Resize(int width, int height)
+{
+	REQUIRE((width >= 0) && (height >= 0));
+	this->width = width;
+	this->height = height;
+	pixels.assign(static_cast<size_t>(width) * height, 0);
+}
+
+void IndexedCanvas::Clear(byte index)
+{
+	std::fill(pixels.begin(), pixels.end(), index);
+}
+
+void IndexedCanvas::SetPalette(const Color* colors, int count, int first)
+{
+	REQUIRE((first >= 0) && (count >= 0) && (first + count <= 256));
+	std::copy_n(colors, count, palette.begin() + first);
+}
+
+void IndexedCanvas::SetPaletteGradient(byte first, byte last, Color start, Color end)
+{
+	REQUIRE(first <= last);
+	int steps = last - first;
+	for(int i = 0; i <= steps; i++)
+		palette[first + i] = Color::Gradient(start, end, (steps > 0) ? static_cast<float>(i) / static_cast<float>(steps) : 0.0f);
+}
+
+void IndexedCanvas::RotatePalette(int steps, byte first, byte last)
+{
+	REQUIRE(first <= last);
+	int count = last - first + 1;
+	steps %= count;
+	if(steps < 0)
+		steps += count;
+	auto begin = palette.begin() + first;
+	std::rotate(begin, begin + (count - steps), begin + count);
+}
+
+const Color* IndexedCanvas::Row(int x, int y, int count, Color* scratch) const
+{
+	LookupSpan(scratch, &pixels[y * width + x], palette.data(), count);
+	return scratch;
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include "core/PixelAllocator.h"
+#if defined(__linux__)
+	#include <sys/mman.h>
+#endif
+
+// The smallest size class, smaller buffers are rounded up to this
+static constexpr size_t MIN_CLASS_SIZE = 256;
+static constexpr int MIN_CLASS_SHIFT = 8;
+
+// Buffers of at least this size may be backed by huge pages
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Most memory the free lists keep, freed buffers beyond this go back to the system
+static constexpr size_t MAX_CACHED_SIZE = 64 * 1024 * 1024;
+
+struct AllocatorState
+{
+	std::mutex mutex;
+	std::vector<std::vector<void*>> freelists;
+	size_t cached = 0;
+	bool hugepages = false;
+};
+
+// The state is never destroyed, so that buffers of static objects can still be freed at exit
+static AllocatorState& State()
+{
+	static AllocatorState* state = new AllocatorState();
+	return *state;
+}
+
+// Rounds the size up to its size class and returns the index of that class. Above the smallest
+// class, every power of two is split in four steps.
+static size_t SizeClass(size_t size, int& index)
+{
+	if(size <= MIN_CLASS_SIZE)
+	{
+		index = 0;
+		return MIN_CLASS_SIZE;
+	}
+	int shift = 63 - __builtin_clzll(static_cast<unsigned long long>(size - 1));
+	size_t step = static_cast<size_t>(1) << (shift - 2);
+	size_t steps = (size + step - 1) / step;
+	index = 1 + (shift - MIN_CLASS_SHIFT) * 4 + static_cast<int>(steps - 5);
+	return steps * step;
+}
+
+void* PixelAllocator::Allocate(size_t size)
+{
+	if(size == 0)
+		return nullptr;
+
+	int index;
+	size_t classsize = SizeClass(size, index);
+	AllocatorState& state = State();
+	bool hugepages;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if((index < static_cast<int>(state.freelists.size())) && !state.freelists[index].empty())
+		{
+			void* ptr = state.freelists[index].back();
+			state.freelists[index].pop_back();
+			state.cached -= classsize;
+			return ptr;
+		}
+		hugepages = state.hugepages;
+	}
+
+	// Huge pages must start on a huge page boundary to be used for the whole buffer
+	// (aligned_alloc wants a size that is a multiple of the alignment)
+	bool huge = hugepages && (classsize >= HUGE_PAGE_SIZE);
+	size_t alignment = huge ? HUGE_PAGE_SIZE : PIXEL_ALIGNMENT;
+	size_t allocsize = (classsize + alignment - 1) / alignment * alignment;
+	void* ptr = std::aligned_alloc(alignment, allocsize);
+	#if defined(__linux__)
+		if(huge && (ptr != nullptr))
+			madvise(ptr, allocsize, MADV_HUGEPAGE);
+	#endif
+	return ptr;
+}
+
+void PixelAllocator::Free(void* ptr, size_t size)
+{
+	if(ptr == nullptr)
+		return;
+
+	int index;
+	size_t classsize = SizeClass(size, index);
+	AllocatorState& state = State();
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if((state.cached + classsize) <= MAX_CACHED_SIZE)
+		{
+			if(index >= static_cast<int>(state.freelists.size()))
+				state.freelists.resize(index + 1);
+			state.freelists[index].push_back(ptr);
+			state.cached += classsize;
+			return;
+		}
+	}
+	std::free(ptr);
+}
+
+void PixelAllocator::SetHugePages(bool enable)
+{
+	#if defined(__linux__)
+		AllocatorState& state = State();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.hugepages = enable;
+	#endif
+}
+
+void PixelAllocator::Trim()
+{
+	AllocatorState& state = State();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	for(std::vector<void*>& list : state.freelists)
+	{
+		for(void* ptr : list)
+			std::free(ptr);
+		list.clear();
+	}
+	state.cached = 0;
+}
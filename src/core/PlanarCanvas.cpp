@@ -0,0 +1,35 @@
+#include <algorithm>
+#include "core/PlanarCanvas.h"
+
+PlanarCanvas::PlanarCanvas()
+{
+	Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+PlanarCanvas::PlanarCanvas(int width, int height)
+{
+	Resize(width, height);
+}
+
+void PlanarCanvas::Resize(int width, int height)
+{
+	REQUIRE((width >= 0) && (height >= 0));
+	this->width = width;
+	this->height = height;
+	stride = (width + PLANAR_VECTOR_WIDTH - 1) / PLANAR_VECTOR_WIDTH * PLANAR_VECTOR_WIDTH;
+	planes.assign(static_cast<size_t>(stride) * height * 4, 0.0f);
+}
+
+void PlanarCanvas::Clear(Color color)
+{
+	size_t planesize = static_cast<size_t>(stride) * height;
+	const byte channels[4] = { color.r, color.g, color.b, color.a };
+	for(int c = 0; c < 4; c++)
+		std::fill_n(planes.begin() + c * planesize, planesize, static_cast<float>(channels[c]) / 255.0f);
+}
+
+const Color* PlanarCanvas::Row(int x, int y, int count, Color* scratch) const
+{
+	InterleaveSpan(scratch, GetRow(0, y) + x, GetRow(1, y) + x, GetRow(2, y) + x, GetRow(3, y) + x, count);
+	return scratch;
+}
@@ -51,8 +51,10 @@ void GradientEffect::Render(Canvas& canvas, uint32_t timeMs)
 void PlasmaEffect::Render(Canvas& canvas, uint32_t timeMs)
 {
     float t = timeMs / 1000.0f;
-    for (int y = 0; y < DISPLAY_HEIGHT; y++) {
-        for (int x = 0; x < DISPLAY_WIDTH; x++) {
+    int width = canvas.Width();
+    int height = canvas.Height();
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
             float v1 = sin(x / 10.0f + t);
             float v2 = sin((y / 10.0f + t) / 2.0f);
             float v3 = sin((x / 10.0f + y / 10.0f + t) / 2.0f);
@@ -67,6 +69,35 @@ void PlasmaEffect::Render(Canvas& canvas, uint32_t timeMs)
     }
 }
 
+PalettePlasmaEffect::PalettePlasmaEffect() : plasma(0, 0)
+{
+    // The same purple to cyan colors as PlasmaEffect, going around once over the palette
+    for (int i = 0; i < 256; i++) {
+        float v = (sin(i * (2.0f * 3.14159265f / 256.0f)) + 1.0f) / 2.0f;
+        colors[i] = Color((byte)(v * 255), (byte)((1.0f - v) * 255), 255);
+    }
+}
+
+void PalettePlasmaEffect::Render(Canvas& canvas, uint32_t timeMs)
+{
+    // Draw the pattern when the size changes
+    if ((plasma.Width() != canvas.Width()) || (plasma.Height() != canvas.Height())) {
+        plasma.Resize(canvas.Width(), canvas.Height());
+        for (int y = 0; y < plasma.Height(); y++) {
+            for (int x = 0; x < plasma.Width(); x++) {
+                float v = sin(x / 16.0f) + sin(y / 8.0f) + sin((x + y) / 16.0f) + sin(sqrt((float)(x * x + y * y)) / 8.0f);
+                plasma.SetPixel(x, y, (byte)((v + 4.0f) * (255.0f / 8.0f)));
+            }
+        }
+    }
+
+    // Cycle the palette about once every 2.5 seconds
+    int offset = (int)((timeMs / 10) & 255);
+    for (int i = 0; i < 256; i++)
+        plasma.SetPaletteColor((byte)i, colors[(i + offset) & 255]);
+    plasma.DrawTo(canvas);
+}
+
 CompositeEffect::CompositeEffect(std::shared_ptr<IEffect> bottom, std::shared_ptr<IEffect> top)
 {
     AddEffect(bottom);
@@ -92,4 +123,9 @@ void CompositeEffect::Render(Canvas& canvas, uint32_t timeMs)
     }
 }
 
+bool CompositeEffect::CoversFrame() const
+{
+    return !effects.empty() && effects[0]->CoversFrame();
+}
+
 }
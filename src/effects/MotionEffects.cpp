@@ -11,35 +11,29 @@ void ScrollEffect::Render(Canvas& canvas, uint32_t timeMs)
     uint32_t dt = timeMs - lastUpdate;
     lastUpdate = timeMs;
 
-    posX += (speedX * dt) / 1000.0f;
-    posY += (speedY * dt) / 1000.0f;
+    posX += (speedX * (float)dt) / 1000.0f;
+    posY += (speedY * (float)dt) / 1000.0f;
 
     // Create temp buffer
     static Canvas tempCanvas; 
     
     // Clear temp
-    tempCanvas.Clear(BLACK);
+    PrepareOffscreen(tempCanvas, canvas, BLACK);
     
     // Render source to temp
     source->Render(tempCanvas, timeMs);
     
-    // Copy temp to simple buffer to handle wrap
-    const Color* src = tempCanvas.GetBuffer();
-    
-    int shiftX = (int)posX % DISPLAY_WIDTH;
-    int shiftY = (int)posY % DISPLAY_HEIGHT;
-    if (shiftX < 0) shiftX += DISPLAY_WIDTH;
-    if (shiftY < 0) shiftY += DISPLAY_HEIGHT;
-    
-    for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
-        for (int x = 0; x < DISPLAY_WIDTH; ++x) {
-            // Source coordinates
-            int sx = (x - shiftX + DISPLAY_WIDTH) % DISPLAY_WIDTH;
-            int sy = (y - shiftY + DISPLAY_HEIGHT) % DISPLAY_HEIGHT;
-            
-            canvas.SetPixel(x, y, src[sy * DISPLAY_WIDTH + sx]);
-        }
-    }
+    // Copy the four parts of the wrapped frame straight to their place
+    int w = tempCanvas.Width();
+    int h = tempCanvas.Height();
+    int shiftX = (int)posX % w;
+    int shiftY = (int)posY % h;
+    if (shiftX < 0) shiftX += w;
+    if (shiftY < 0) shiftY += h;
+    canvas.CopyRegion(tempCanvas, Rect(0, 0, w - shiftX, h - shiftY), Point(shiftX, shiftY));
+    canvas.CopyRegion(tempCanvas, Rect(w - shiftX, 0, shiftX, h - shiftY), Point(0, shiftY));
+    canvas.CopyRegion(tempCanvas, Rect(0, h - shiftY, w - shiftX, shiftY), Point(shiftX, 0));
+    canvas.CopyRegion(tempCanvas, Rect(w - shiftX, h - shiftY, shiftX, shiftY), Point(0, 0));
 }
 
 // End of previous methods
@@ -51,7 +45,7 @@ void ShakeEffect::Render(Canvas& canvas, uint32_t timeMs)
     
     // Render source to temp
     static Canvas temp;
-    temp.Clear(Color(0,0,0,0));
+    PrepareOffscreen(temp, canvas);
     source->Render(temp, timeMs);
     
     int dx = (rand() % (intensity * 2)) - intensity;
@@ -66,15 +60,15 @@ void JitterEffect::Render(Canvas& canvas, uint32_t timeMs)
     if (!source) return;
     
     static Canvas temp;
-    temp.Clear(Color(0,0,0,0));
+    PrepareOffscreen(temp, canvas);
     source->Render(temp, timeMs);
     
     // Scanline jitter
-    for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
+    for (int y = 0; y < canvas.Height(); ++y) {
         int off = (rand() % 3) - 1; // -1, 0, 1
-        for (int x = 0; x < DISPLAY_WIDTH; ++x) {
+        for (int x = 0; x < canvas.Width(); ++x) {
              // Read from x,y, write to x+off,y
-             if (x+off >= 0 && x+off < DISPLAY_WIDTH) {
+             if (x+off >= 0 && x+off < canvas.Width()) {
                  Color c = temp.GetPixel(x, y);
                  canvas.SetPixel(x + off, y, c);
              }
@@ -27,39 +27,7 @@ void FadeEffect::Render(Canvas& canvas, uint32_t timeMs)
 void BlurEffect::Render(Canvas& canvas, uint32_t timeMs)
 {
     if (source) source->Render(canvas, timeMs);
-    
-    // Copy canvas to temp buffer
-    int width = canvas.Width();
-    int height = canvas.Height();
-    std::vector<Color> buffer(width * height);
-    
-    const Color* src = canvas.GetBuffer();
-    std::copy(src, src + (width * height), buffer.begin());
-    
-    // Box blur 3x3
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int r = 0, g = 0, b = 0;
-            int count = 0;
-            
-            for (int ky = -1; ky <= 1; ++ky) {
-                for (int kx = -1; kx <= 1; ++kx) {
-                    int ny = y + ky;
-                    int nx = x + kx;
-                    
-                    if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-                        Color c = buffer[ny * width + nx];
-                        r += c.r;
-                        g += c.g;
-                        b += c.b;
-                        count++;
-                    }
-                }
-            }
-            
-            canvas.SetPixel(x, y, Color(r / count, g / count, b / count));
-        }
-    }
+    convolution.BoxBlur(canvas, radius);
 }
 
 // End of previous methods
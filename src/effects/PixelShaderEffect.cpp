@@ -3,34 +3,87 @@
 
 namespace libled {
 
+// Returns the seconds since the first frame, which sets the start time when it is the first.
+// All bands of the first frame get the same time, whichever sets it.
+static float ElapsedSeconds(std::atomic<int64_t>& startTime, uint32_t timeMs)
+{
+    int64_t start = -1;
+    if (startTime.compare_exchange_strong(start, timeMs))
+        start = timeMs;
+    return (timeMs - start) / 1000.0f;
+}
+
 PixelShaderEffect::PixelShaderEffect(ShaderFunction fn)
-    : shader(fn), startTime(0), started(false)
+    : shader(fn), startTime(-1)
 {
 }
 
 void PixelShaderEffect::Reset()
 {
-    started = false;
-    startTime = 0;
+    startTime = -1;
 }
 
 void PixelShaderEffect::Render(Canvas& canvas, uint32_t timeMs)
 {
-    if (!started) {
-        startTime = timeMs;
-        started = true;
-    }
-
-    float time = (timeMs - startTime) / 1000.0f;
+    float time = ElapsedSeconds(startTime, timeMs);
 
-    for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
-        for (int x = 0; x < DISPLAY_WIDTH; ++x) {
-            float u = x / (float)DISPLAY_WIDTH;
-            float v = y / (float)DISPLAY_HEIGHT;
+    // Only shade the pixels we can draw, which may be a band of the frame
+    Rect clip = canvas.GetClip();
+    float width = (float)canvas.Width();
+    float height = (float)canvas.Height();
+    for (int y = clip.Top(); y <= clip.Bottom(); ++y) {
+        for (int x = clip.Left(); x <= clip.Right(); ++x) {
+            float u = x / width;
+            float v = y / height;
             Color c = shader(u, v, time);
-            canvas.SetPixel(x, y, c);
+            canvas.SetPixelStraight(x, y, c);
         }
     }
 }
 
+PlanarShaderEffect::PlanarShaderEffect(RowShaderFunction fn)
+    : shader(fn), startTime(-1)
+{
+}
+
+void PlanarShaderEffect::Reset()
+{
+    startTime = -1;
+}
+
+void PlanarShaderEffect::Render(Canvas& canvas, uint32_t timeMs)
+{
+    float time = ElapsedSeconds(startTime, timeMs);
+
+    // Only shade the pixels we can draw, which may be a band of the frame
+    Rect clip = canvas.GetClip();
+    int left = clip.Left();
+    int top = clip.Top();
+    int right = clip.Right();
+    int bottom = clip.Bottom();
+    if ((left > right) || (top > bottom))
+        return;
+
+    // The planes are per thread, so that the bands can shade at the same time
+    static thread_local PlanarCanvas planes(0, 0);
+    if ((planes.Width() != right - left + 1) || (planes.Height() != bottom - top + 1))
+        planes.Resize(right - left + 1, bottom - top + 1);
+
+    float width = (float)canvas.Width();
+    float height = (float)canvas.Height();
+    ShaderRow row;
+    row.u = left / width;
+    row.du = 1.0f / width;
+    row.count = planes.Stride();
+    for (int y = top; y <= bottom; ++y) {
+        row.r = planes.GetRow(0, y - top);
+        row.g = planes.GetRow(1, y - top);
+        row.b = planes.GetRow(2, y - top);
+        row.a = planes.GetRow(3, y - top);
+        row.v = y / height;
+        shader(row, time);
+    }
+    planes.DrawTo(canvas, Point(left, top));
+}
+
 }
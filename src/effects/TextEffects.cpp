@@ -183,7 +183,7 @@ void TextShineEffect::DrawShine(Canvas& canvas, Rect tr)
     offset.step(dt);
     
     // Draw the shine only where content pixels are
-    Size canvasSize = tempCanvas.GetSize();
+    Size canvasSize = mask.GetSize();
     for (int sy = 0; sy < tr.height; sy++)
     {
         for (int sx = 0; sx < SHINE_WIDTH; sx++)
@@ -192,7 +192,7 @@ void TextShineEffect::DrawShine(Canvas& canvas, Rect tr)
             int y = tr.y + sy;
             if ((x >= 0) && (x < canvasSize.width) && (y >= 0) && (y < canvasSize.height))
             {
-                if (tempCanvas.GetPixel(x, y).a > 0)
+                if (mask.GetPixel(x, y))
                     canvas.SetPixel(x, y, WHITE);
             }
         }
@@ -201,21 +201,18 @@ void TextShineEffect::DrawShine(Canvas& canvas, Rect tr)
 
 void TextShineEffect::Draw(Canvas& canvas, const Text& text, int outline, Point pos)
 {
-    // Draw the text on a separate canvas
-    tempCanvas.Clear(Color(0, 0, 0, 0));
-    text.DrawOutlineMask(tempCanvas, pos, outline, WHITE);
-    text.DrawMask(tempCanvas, pos, WHITE);
+    // Draw the text in the mask
+    mask.Clear();
+    text.DrawOutline(mask, pos, outline);
+    text.Draw(mask, pos);
     DrawShine(canvas, text.GetTextRect(pos));
 }
 
 void TextShineEffect::Draw(Canvas& canvas, const IImage& image, Point pos)
 {
-    // Draw the image on a separate canvas
-    tempCanvas.Clear(Color(0, 0, 0, 0));
-    if (image.HasColors())
-        tempCanvas.DrawColorImageMask(pos, image);
-    else
-        tempCanvas.DrawMonoImageMask(pos, image, WHITE);
+    // Draw the image in the mask
+    mask.Clear();
+    mask.DrawImage(pos, image);
     DrawShine(canvas, Rect(pos, image.GetSize()));
 }
 
@@ -288,46 +285,47 @@ void TextScaleEffect::Render(Canvas& canvas, uint32_t timeMs)
     // Skip rendering if width is zero or negative
     if (textWidth <= 0) return;
     
-    // Draw text to temp canvas at full size
+    // The text is scaled as if it was drawn on a canvas the size of the screen, which is scaled
+    // about the center of the screen. Only the part of that frame with the text (plus outline)
+    // is drawn, into a temp canvas with its left-top at origin.
+    Size frameSize = canvas.GetSize();
+    int outline = texture ? 2 : 0;
+    Rect textRect = text.GetTextRect(position);
+    int left = std::max(textRect.x - outline, 0);
+    int top = std::max(textRect.y - outline, 0);
+    int right = std::min(textRect.Right() + outline, frameSize.width - 1);
+    int bottom = std::min(textRect.Bottom() + outline, frameSize.height - 1);
+    if ((left > right) || (top > bottom)) return;
+    Point origin(left, top);
+    Point localPos(position.x - origin.x, position.y - origin.y);
+    Size tempCanvasSize(right - left + 1, bottom - top + 1);
+    if ((tempCanvas.Width() != tempCanvasSize.width) || (tempCanvas.Height() != tempCanvasSize.height))
+        tempCanvas.Resize(tempCanvasSize.width, tempCanvasSize.height);
     tempCanvas.Clear(Color(0, 0, 0, 0));
     
     if (texture) {
-        text.DrawOutlineMask(tempCanvas, position, 2, BLACK);
-        text.DrawTexturedMask(tempCanvas, position, *texture);
+        text.DrawOutlineMask(tempCanvas, localPos, outline, BLACK);
+        text.DrawTexturedMask(tempCanvas, localPos, *texture);
     } else {
-        text.DrawMask(tempCanvas, position, WHITE);
+        text.DrawMask(tempCanvas, localPos, WHITE);
     }
     
-    // Calculate scaled height maintaining aspect ratio
-    Size tempCanvasSize = tempCanvas.GetSize();
+    // Calculate scaled height of the frame maintaining aspect ratio
     int textHeight = static_cast<int>(std::roundf(
-        (static_cast<float>(textWidth) / static_cast<float>(tempCanvasSize.width)) * 
-        static_cast<float>(tempCanvasSize.height)
+        (static_cast<float>(textWidth) / static_cast<float>(frameSize.width)) * 
+        static_cast<float>(frameSize.height)
     ));
     
-    // Calculate offset for centering
-    Point offset((canvas.Width() - textWidth) / 2, (canvas.Height() - textHeight) / 2);
+    // Calculate offset for centering the scaled frame on the screen
+    Point offset((frameSize.width - textWidth) / 2, (frameSize.height - textHeight) / 2);
     
     if ((textWidth > 0) && (textHeight > 0)) {
-        // Nearest-neighbor scaling algorithm
-        int x_ratio = ((tempCanvasSize.width << 16) / textWidth) + 1;
-        int y_ratio = ((tempCanvasSize.height << 16) / textHeight) + 1;
-        
-        for (int i = 0; i < textHeight; i++) {
-            for (int j = 0; j < textWidth; j++) {
-                int x2 = (j * x_ratio) >> 16;
-                int y2 = (i * y_ratio) >> 16;
-                
-                if (offset.x + j >= 0 && offset.x + j < canvas.Width() &&
-                    offset.y + i >= 0 && offset.y + i < canvas.Height()) {
-                    
-                    Color c = tempCanvas.GetPixel(x2, y2);
-                    if (c.a > 0) {
-                         canvas.BlendPixel(offset.x + j, offset.y + i, c);
-                    }
-                }
-            }
-        }
+        // Nearest-neighbor scaling of the temp canvas to its place in the scaled frame
+        Transform transform = Transform::Translation(static_cast<float>(offset.x), static_cast<float>(offset.y)) *
+            Transform::Scale(static_cast<float>(textWidth) / static_cast<float>(frameSize.width),
+                             static_cast<float>(textHeight) / static_cast<float>(frameSize.height)) *
+            Transform::Translation(static_cast<float>(origin.x), static_cast<float>(origin.y));
+        canvas.DrawColorImageTransformed(tempCanvas, transform, Sampling::Nearest, BlendMode::Blend);
     }
 }
 
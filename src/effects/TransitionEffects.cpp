@@ -15,10 +15,10 @@ void DissolveEffect::Render(Canvas& canvas, uint32_t timeMs)
         progress = 1.0f - ((float)(tMs - durationMs) / (float)durationMs);
     }
 
-    canvasA.Clear(Color(0,0,0,0));
+    PrepareOffscreen(canvasA, canvas);
     if (sourceA) sourceA->Render(canvasA, timeMs);
     
-    canvasB.Clear(Color(0,0,0,0));
+    PrepareOffscreen(canvasB, canvas);
     if (sourceB) sourceB->Render(canvasB, timeMs);
     
     // Draw A
@@ -26,14 +26,14 @@ void DissolveEffect::Render(Canvas& canvas, uint32_t timeMs)
     
     // Dissolve B over A
     // Use a pseudo-random threshold based on x,y
-    for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
-        for (int x = 0; x < DISPLAY_WIDTH; ++x) {
+    for (int y = 0; y < canvas.Height(); ++y) {
+        for (int x = 0; x < canvas.Width(); ++x) {
              // Deterministic noise
              int noise = (x * 37 + y * 17) % 100; // 0-99
              float threshold = progress * 100.0f;
              
              if (noise < threshold) {
-                 Color c = canvasB.GetPixel(x, y);
+                 Color c = canvasB.GetPixelStraight(x, y);
                  // Alpha blend if c has transparency
                  canvas.BlendPixel(x, y, c);
              }
@@ -43,7 +43,7 @@ void DissolveEffect::Render(Canvas& canvas, uint32_t timeMs)
 
 MeltTransitionEffect::MeltTransitionEffect(std::shared_ptr<IEffect> src, std::shared_ptr<IEffect> dst, uint32_t dur)
     : source(src), dest(dst), duration(dur), startTime(0), started(false), 
-      columnOffsets(DISPLAY_WIDTH, 0), initialized(false)
+      initialized(false)
 {
 }
 
@@ -52,7 +52,7 @@ void MeltTransitionEffect::Reset()
     started = false;
     startTime = 0;
     initialized = false;
-    std::fill(columnOffsets.begin(), columnOffsets.end(), 0);
+    columnOffsets.clear();
 }
 
 void MeltTransitionEffect::Render(Canvas& canvas, uint32_t timeMs)
@@ -65,15 +65,16 @@ void MeltTransitionEffect::Render(Canvas& canvas, uint32_t timeMs)
         const int MAX_OFFSET_MS = 400;
         const int MAX_DELTA_OFFSET_MS = 100;
         
+        columnOffsets.resize(canvas.Width());
         int off = (rand() % MAX_OFFSET_MS);
-        for (int x = 0; x < DISPLAY_WIDTH; ++x) {
+        for (int x = 0; x < canvas.Width(); ++x) {
             int delta = (rand() % (MAX_DELTA_OFFSET_MS * 2)) - MAX_DELTA_OFFSET_MS;
             off = std::max(0, std::min(MAX_OFFSET_MS, off + delta));
             columnOffsets[x] = off;
         }
         
         // Capture the source into sourceCanvas
-        sourceCanvas.Clear(Color(0,0,0,0));
+        PrepareOffscreen(sourceCanvas, canvas);
         if (source) source->Render(sourceCanvas, timeMs);
         initialized = true;
     }
@@ -89,7 +90,7 @@ void MeltTransitionEffect::Render(Canvas& canvas, uint32_t timeMs)
     }
     
     // Render destination as background
-    destCanvas.Clear(Color(0,0,0,0));
+    PrepareOffscreen(destCanvas, canvas);
     if (dest) dest->Render(destCanvas, timeMs);
     destCanvas.CopyTo(canvas);
     
@@ -97,13 +98,13 @@ void MeltTransitionEffect::Render(Canvas& canvas, uint32_t timeMs)
     // Original: offset = max(dt - offsets[x], 0) / MELT_SPEED
     const int MELT_SPEED = 30; // Milliseconds per pixel
     
-    for (int x = 0; x < DISPLAY_WIDTH; ++x) {
+    for (int x = 0; x < (int)columnOffsets.size(); ++x) {
         int dt = (int)elapsed - columnOffsets[x];
         if (dt < 0) dt = 0;
         int offset = dt / MELT_SPEED;
         
         // Copy pixels from source with vertical offset
-        for (int y = 0; y < DISPLAY_HEIGHT - offset; ++y) {
+        for (int y = 0; y < sourceCanvas.Height() - offset; ++y) {
             Color c = sourceCanvas.GetPixel(x, y);
             if (c.a > 0) {
                 canvas.SetPixel(x, y + offset, c);
@@ -124,24 +125,8 @@ float GetProgress(uint32_t timeMs, int durationMs) {
 void SlideTransitionEffect::Render(Canvas& canvas, uint32_t timeMs) {
     float p = GetProgress(timeMs, durationMs);
     
-    // Render sources
-    canvasA.Clear(Color(0,0,0,0)); if (sourceA) sourceA->Render(canvasA, timeMs);
-    canvasB.Clear(Color(0,0,0,0)); if (sourceB) sourceB->Render(canvasB, timeMs);
-    
-    int w = DISPLAY_WIDTH;
-    int h = DISPLAY_HEIGHT;
-    int xOffset = 0, yOffset = 0;
-    
-    if (dir == TransitionDirection::Left) xOffset = (int)(w * p);
-    else if (dir == TransitionDirection::Right) xOffset = -(int)(w * p);
-    else if (dir == TransitionDirection::Up) yOffset = (int)(h * p);
-    else if (dir == TransitionDirection::Down) yOffset = -(int)(h * p);
-    
-    // Draw A (moving out)
-    // If Left: A moves left (-xOffset)
-    // Wait, standard slide: B pushes A.
-    // Let's implement: A stays, B slides OVER A? Or Push?
-    // Push is nicer.
+    int w = canvas.Width();
+    int h = canvas.Height();
     
     // Logic for Push Left:
     // A starts at 0, ends at -W.
@@ -155,8 +140,7 @@ void SlideTransitionEffect::Render(Canvas& canvas, uint32_t timeMs) {
     } else if (dir == TransitionDirection::Right) {
         posA.x = (int)(w * p);
         posB.x = -w + (int)(w * p);
-    } // ... implement others similarly if needed, sticking to L/R for now as primary
-    else if (dir == TransitionDirection::Up) {
+    } else if (dir == TransitionDirection::Up) {
         posA.y = -(int)(h * p);
         posB.y = h - (int)(h * p);
     } else {
@@ -164,26 +148,30 @@ void SlideTransitionEffect::Render(Canvas& canvas, uint32_t timeMs) {
         posB.y = -h + (int)(h * p);
     }
 
-    canvas.DrawColorImage(posA, canvasA);
-    canvas.DrawColorImage(posB, canvasB);
+    // Render the sources directly at their positions on the canvas
+    CanvasView viewA(canvas, posA, canvas.GetSize());
+    viewA.Clear(Color(0,0,0,0));
+    if (sourceA) sourceA->Render(viewA, timeMs);
+    
+    CanvasView viewB(canvas, posB, canvas.GetSize());
+    viewB.Clear(Color(0,0,0,0));
+    if (sourceB) sourceB->Render(viewB, timeMs);
 }
 
 // --- Wipe Transition ---
 void WipeTransitionEffect::Render(Canvas& canvas, uint32_t timeMs) {
     float p = GetProgress(timeMs, durationMs);
     
-    canvasA.Clear(Color(0,0,0,0)); if (sourceA) sourceA->Render(canvasA, timeMs);
-    canvasB.Clear(Color(0,0,0,0)); if (sourceB) sourceB->Render(canvasB, timeMs);
-    
     // Draw A first
-    canvas.DrawColorImage(Point(0,0), canvasA);
+    canvas.Clear(Color(0,0,0,0));
+    if (sourceA) sourceA->Render(canvas, timeMs);
     
     // Draw B clipped
     // If wipe left: B appears from Right? Or Wipe Right (reveal B from Left)?
     // Usually Wipe Right means the line moves right, revealing B.
     
-    int w = DISPLAY_WIDTH;
-    int h = DISPLAY_HEIGHT;
+    int w = canvas.Width();
+    int h = canvas.Height();
     Rect clipRect(0, 0, w, h);
     
     if (dir == TransitionDirection::Right) {
@@ -202,56 +190,33 @@ void WipeTransitionEffect::Render(Canvas& canvas, uint32_t timeMs) {
         clipRect.height = (int)(h * p);
     }
     
-    // Helper to draw part of B
-    // We can use DrawColorImage logic but custom rects
-    // Or just manual loop for clipping since we have direct access and it's fast
-    
-    for (int y = clipRect.y; y < clipRect.y + clipRect.height; ++y) {
-        for (int x = clipRect.x; x < clipRect.x + clipRect.width; ++x) {
-            if (x >= 0 && x < w && y >= 0 && y < h) {
-                canvas.SetPixel(x, y, canvasB.GetPixel(x, y));
-            }
-        }
-    }
+    // B renders directly on the canvas, limited to the wiped area
+    canvas.PushClip(clipRect);
+    canvas.Clear(Color(0,0,0,0));
+    if (sourceB) sourceB->Render(canvas, timeMs);
+    canvas.PopClip();
 }
 
 // --- Zoom Transition ---
 void ZoomTransitionEffect::Render(Canvas& canvas, uint32_t timeMs) {
     float p = GetProgress(timeMs, durationMs);
     
-    canvasA.Clear(Color(0,0,0,0)); if (sourceA) sourceA->Render(canvasA, timeMs);
-    canvasB.Clear(Color(0,0,0,0)); if (sourceB) sourceB->Render(canvasB, timeMs);
+    PrepareOffscreen(canvasA, canvas); if (sourceA) sourceA->Render(canvasA, timeMs);
+    PrepareOffscreen(canvasB, canvas); if (sourceB) sourceB->Render(canvasB, timeMs);
     
     // Zoom In: A scales up and fades out? Or B scales in from 0?
     // Let's do: Scale B from 0 to 1 over A.
     
     canvas.DrawColorImage(Point(0,0), canvasA);
     
-    // Nearest neighbor scale B
-    // Center is (W/2, H/2)
+    // Scale B around the center
     float scale = p;
     if (scale <= 0.01f) return;
     
-    int w = DISPLAY_WIDTH;
-    int h = DISPLAY_HEIGHT;
-    
-    int newW = (int)(w * scale);
-    int newH = (int)(h * scale);
-    int offX = (w - newW) / 2;
-    int offY = (h - newH) / 2;
-    
-    for (int y = 0; y < newH; ++y) {
-        for (int x = 0; x < newW; ++x) {
-            // Map to source B coordinates
-            int srcX = (int)((x / (float)newW) * w);
-            int srcY = (int)((y / (float)newH) * h);
-            
-            Color c = canvasB.GetPixel(srcX, srcY);
-            if (c.a > 0) {
-                canvas.SetPixel(x + offX, y + offY, c);
-            }
-        }
-    }
+    float cx = canvas.Width() * 0.5f;
+    float cy = canvas.Height() * 0.5f;
+    Transform transform = Transform::Translation(cx, cy) * Transform::Scale(scale, scale) * Transform::Translation(-cx, -cy);
+    canvas.DrawColorImageTransformed(canvasB, transform, pixelated ? Sampling::Nearest : Sampling::Bilinear, BlendMode::Blend);
 }
 
 }
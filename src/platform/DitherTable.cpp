@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cmath>
+#include "platform/DitherTable.h"
+
+// The order of the thresholds in the 4 x 4 pattern. Neighboring pixels have thresholds far
+// apart, so that the pixels which go to the level above are spread evenly.
+static constexpr int BAYER[4][4] =
+{
+	{ 0, 8, 2, 10 },
+	{ 12, 4, 14, 6 },
+	{ 3, 11, 1, 9 },
+	{ 15, 7, 13, 5 }
+};
+
+// How far the thresholds move in every frame of the temporal pattern. Consecutive frames are
+// far apart too, so that a pixel halfway between two levels alternates every frame instead of
+// flickering slowly.
+static constexpr int TEMPORAL_OFFSETS[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+
+DitherTable::DitherTable() :
+	mode(DitherMode::None),
+	frame(0)
+{
+	for(auto& table : outputs)
+		for(int v = 0; v < 256; v++)
+			table[v] = static_cast<byte>(v);
+}
+
+DitherMode DitherTable::ParseMode(const String& name)
+{
+	String lowered = name.ToLower();
+	if(lowered == "ordered")
+		return DitherMode::Ordered;
+	if(lowered == "temporal")
+		return DitherMode::Temporal;
+	return DitherMode::None;
+}
+
+void DitherTable::Build(DitherMode mode, const float* targets, const byte* codes, int levelcount)
+{
+	REQUIRE((levelcount >= 2) && (levelcount <= 256));
+	this->mode = mode;
+	for(int k = 0; k < 16; k++)
+	{
+		float threshold = (static_cast<float>(k) + 0.5f) / 16.0f;
+		for(int v = 0; v < 256; v++)
+		{
+			// Small errors in the targets must not push exact levels down
+			float target = std::clamp(targets[v], 0.0f, static_cast<float>(levelcount - 1));
+			int level = static_cast<int>(std::floor(target + 0.0001f));
+			if((mode != DitherMode::None) && ((target - static_cast<float>(level)) > threshold))
+				level++;
+			outputs[k][v] = codes[std::min(level, levelcount - 1)];
+		}
+	}
+}
+
+void DitherTable::GetRow(int y, const byte* row[4]) const
+{
+	int offset = (mode == DitherMode::Temporal) ? TEMPORAL_OFFSETS[frame] : 0;
+	for(int i = 0; i < 4; i++)
+		row[i] = outputs[(BAYER[y & 3][i] + offset) & 15].data();
+}
@@ -1,6 +1,7 @@
 #include <utility>
 #include <cassert>
 #include <math.h>
+#include <cmath>
 #include "utils/Tools.h"
 #include "platform/DotMatrixGraphics.h"
 #include "utils/Configuration.h"
@@ -10,7 +11,9 @@
 DotMatrixGraphics::DotMatrixGraphics(const Configuration& cfg) :
 	display(nullptr),
 	displaycanvas(nullptr),
-	brightness(cfg.GetInt("Graphics.Brightness", 100))
+	brightness(cfg.GetInt("Graphics.Brightness", 100)),
+	pwmbits(cfg.GetInt("Graphics.PWM_Bits", 11)),
+	luminancecorrect(cfg.GetBool("Graphics.Luminance_Correct", true))
 {
 	// Check if running as root or with elevated privileges
 	uid_t uid_me = getuid();
@@ -35,22 +38,57 @@ DotMatrixGraphics::DotMatrixGraphics(const Configuration& cfg) :
 	matrixoptions.parallel = 1;
 	matrixoptions.show_refresh_rate = false;
 	matrixoptions.brightness = brightness;
-	matrixoptions.pwm_bits = cfg.GetInt("Graphics.PWM_Bits", 11);
+	matrixoptions.pwm_bits = pwmbits;
 	matrixoptions.pwm_dither_bits = cfg.GetInt("Graphics.PWM_Dither_Bits", 0);
 	matrixoptions.pwm_lsb_nanoseconds = cfg.GetInt("Graphics.PWM_LSB_Nanoseconds", 130);
 	runtimeoptions.gpio_slowdown = cfg.GetInt("Graphics.GPIO_Slowdown", 4);
 
+	// With less than 8 PWM bits, the display can not show every canvas value. Dithering hides
+	// the steps between the levels it can show. We then do the luminance correction and
+	// brightness ourselves, so that the levels we dither between are the levels on the display.
+	DitherMode dithermode = DitherTable::ParseMode(cfg.GetString("Graphics.Dither", "none"));
+	if(pwmbits >= 8)
+		dithermode = DitherMode::None;
+	if(dithermode != DitherMode::None)
+		matrixoptions.brightness = 100;
+
 	// Initialize the matrix display
 	std::cout << "Initializing graphics on " << hwmapping << "..." << std::endl;
 	display = rgb_matrix::CreateMatrixFromOptions(matrixoptions, runtimeoptions);
 	ENSURE(display != nullptr);
-	display->set_luminance_correct(cfg.GetBool("Graphics.Luminance_Correct", true));
+	display->set_luminance_correct(luminancecorrect && (dithermode == DitherMode::None));
+	if(dithermode != DitherMode::None)
+		BuildDither(dithermode);
 
 	// Get a canvas to draw on
 	displaycanvas = display->CreateFrameCanvas();
 	ENSURE(displaycanvas != nullptr);
 }
 
+void DotMatrixGraphics::BuildDither(DitherMode mode)
+{
+	// The display shows the top PWM bits of the values we give it, so every level has a value
+	// and the targets are the brightness of the canvas values in levels. The luminance
+	// correction follows CIE 1931 lightness, like the display does when it corrects itself.
+	int levelcount = 1 << pwmbits;
+	float targets[256];
+	byte codes[256];
+	for(int l = 0; l < levelcount; l++)
+		codes[l] = static_cast<byte>(l << (8 - pwmbits));
+	for(int v = 0; v < 256; v++)
+	{
+		float lightness = static_cast<float>(v) * static_cast<float>(brightness) / 255.0f;
+		float luminance = lightness / 100.0f;
+		if(luminancecorrect)
+			luminance = (lightness <= 8.0f) ? (lightness / 902.3f) : std::pow((lightness + 16.0f) / 116.0f, 3.0f);
+		targets[v] = luminance * static_cast<float>(levelcount - 1);
+	}
+	dither.Build(mode, targets, codes, levelcount);
+
+	// Every pixel must be converted again
+	previousdamage.Resize(0, 0);
+}
+
 DotMatrixGraphics::~DotMatrixGraphics()
 {
 	display->Clear();
@@ -60,16 +98,52 @@ DotMatrixGraphics::~DotMatrixGraphics()
 
 void DotMatrixGraphics::Present(Canvas& sourcecanvas)
 {
-	// Write all our renderbuffer pixels to the display canvas
-	const Color* p = sourcecanvas.GetBuffer();
-	for(int y = 0; y < DISPLAY_HEIGHT; y++)
+	REQUIRE((sourcecanvas.Width() == DISPLAY_WIDTH) && (sourcecanvas.Height() == DISPLAY_HEIGHT));
+
+	// The display canvas we get back from a swap holds the frame before the previous frame.
+	// So it needs the pixels damaged in the previous frame as well as those in this frame.
+	const Damage& damage = sourcecanvas.GetDamage();
+	if((previousdamage.Width() != damage.Width()) || (previousdamage.Height() != damage.Height()))
 	{
-		for(int x = 0; x < DISPLAY_WIDTH; x++)
+		previousdamage.Resize(damage.Width(), damage.Height());
+		previousdamage.AddAll();
+	}
+	updatedamage = previousdamage;
+	updatedamage.Add(damage);
+	previousdamage = damage;
+
+	// The temporal dither pattern changes every pixel in every frame
+	if(dither.ChangesEveryFrame())
+		updatedamage.AddAll();
+
+	// Write the damaged renderbuffer pixels to the display canvas, dithering them on the way
+	for(int y = updatedamage.Top(); y <= updatedamage.Bottom(); y++)
+	{
+		if(!updatedamage.IsRowDamaged(y))
+			continue;
+
+		const Color* p = sourcecanvas.GetBuffer() + y * sourcecanvas.Stride() + updatedamage.RowLeft(y);
+		if(dither.GetMode() == DitherMode::None)
+		{
+			for(int x = updatedamage.RowLeft(y); x <= updatedamage.RowRight(y); x++)
+			{
+				displaycanvas->SetPixel(x, y, p->r, p->g, p->b);
+				p++;
+			}
+		}
+		else
 		{
-			displaycanvas->SetPixel(x, y, p->r, p->g, p->b);
-			p++;
+			const byte* tables[4];
+			dither.GetRow(y, tables);
+			for(int x = updatedamage.RowLeft(y); x <= updatedamage.RowRight(y); x++)
+			{
+				const byte* t = tables[x & 3];
+				displaycanvas->SetPixel(x, y, t[p->r], t[p->g], t[p->b]);
+				p++;
+			}
 		}
 	}
+	dither.NextFrame();
 
 	// Show the canvas on display
 	displaycanvas = display->SwapOnVSync(displaycanvas);
@@ -78,7 +152,10 @@ void DotMatrixGraphics::Present(Canvas& sourcecanvas)
 void DotMatrixGraphics::SetBrightness(int b)
 {
 	brightness = std::clamp(b, 50, 100);
-	display->SetBrightness(static_cast<uint8_t>(brightness));
+	if(dither.GetMode() == DitherMode::None)
+		display->SetBrightness(static_cast<uint8_t>(brightness));
+	else
+		BuildDither(dither.GetMode());
 }
 
 int DotMatrixGraphics::GetBrightness() const
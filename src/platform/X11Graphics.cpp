@@ -15,7 +15,9 @@ X11Graphics::X11Graphics(const Configuration& cfg) :
 	screen(0),
 	window(0),
 	img(nullptr),
-	imgdata(nullptr)
+	imgdata(nullptr),
+	exposed(true),
+	quantize(false)
 {
 	unsigned long black, white;
 
@@ -57,6 +59,24 @@ X11Graphics::X11Graphics(const Configuration& cfg) :
 			XPutPixel(img, x, y, 0);
 		}
 	}
+
+	// Simulate the levels of the PWM bits. A monitor needs no luminance correction, so the
+	// levels are evenly spread over the canvas values.
+	int pwmbits = cfg.GetInt("Graphics.PWM_Bits", 11);
+	if(pwmbits < 8)
+	{
+		int levelcount = 1 << pwmbits;
+		float targets[256];
+		byte codes[256];
+		for(int v = 0; v < 256; v++)
+			targets[v] = static_cast<float>(v * (levelcount - 1)) / 255.0f;
+		for(int l = 0; l < levelcount; l++)
+			codes[l] = static_cast<byte>((l * 255) / (levelcount - 1));
+		dither.Build(DitherTable::ParseMode(cfg.GetString("Graphics.Dither", "none")), targets, codes, levelcount);
+		quantize = true;
+		alldamage.Resize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+		alldamage.AddAll();
+	}
 }
 
 X11Graphics::~X11Graphics()
@@ -72,24 +92,45 @@ X11Graphics::~X11Graphics()
 
 void X11Graphics::Present(Canvas& sourcecanvas)
 {
-	const Color* p = sourcecanvas.GetBuffer();
-	for(int y = 0; y < DISPLAY_HEIGHT; y++)
+	REQUIRE((sourcecanvas.Width() == DISPLAY_WIDTH) && (sourcecanvas.Height() == DISPLAY_HEIGHT));
+
+	// Only the damaged pixels need to be updated in our image, unless the dither pattern
+	// changes every pixel in every frame
+	const Damage& damage = (quantize && dither.ChangesEveryFrame()) ? alldamage : sourcecanvas.GetDamage();
+
+	for(int y = damage.Top(); y <= damage.Bottom(); y++)
 	{
-		for(int x = 0; x < DISPLAY_WIDTH; x++)
+		if(!damage.IsRowDamaged(y))
+			continue;
+
+		const byte* tables[4];
+		if(quantize)
+			dither.GetRow(y, tables);
+
+		const Color* p = sourcecanvas.GetBuffer() + y * sourcecanvas.Stride() + damage.RowLeft(y);
+		for(int x = damage.RowLeft(y); x <= damage.RowRight(y); x++)
 		{
 			int ox = x * DOT_SIZE;
 			int oy = y * DOT_SIZE;
 
+			// The color the panel shows
+			Color c = *p;
+			if(quantize)
+			{
+				const byte* t = tables[x & 3];
+				c = Color(t[p->r], t[p->g], t[p->b]);
+			}
+
 			// Full bright color
-			unsigned long x1 = p->b | (p->g << 8) | (p->r << 16);
+			unsigned long x1 = c.b | (c.g << 8) | (c.r << 16);
 
 			// Less bright color
-			Color lessp = *p;
+			Color lessp = c;
 			lessp.ModulateRGB(DOT_LESS_BRIGHTNESS);
 			unsigned long x2 = lessp.b | (lessp.g << 8) | (lessp.r << 16);
 
 			// Half bright color
-			Color darkp = *p;
+			Color darkp = c;
 			darkp.ModulateRGB(DOT_DARK_BRIGHTNESS);
 			unsigned long x3 = darkp.b | (darkp.g << 8) | (darkp.r << 16);
 
@@ -114,7 +155,17 @@ void X11Graphics::Present(Canvas& sourcecanvas)
 		}
 	}
 
-    XPutImage(display, window, gc, img, 0, 0, WINDOW_BORDER, WINDOW_BORDER, DISPLAY_WIDTH * DOT_SIZE, DISPLAY_HEIGHT * DOT_SIZE);
+	if(quantize)
+		dither.NextFrame();
+
+	// Put the damaged part of the image on the window, or all of it when the window was exposed
+	Rect r = exposed ? Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT) : damage.Bounds();
+	exposed = false;
+	if(!r.IsEmpty())
+	{
+		XPutImage(display, window, gc, img, r.x * DOT_SIZE, r.y * DOT_SIZE, WINDOW_BORDER + r.x * DOT_SIZE, WINDOW_BORDER + r.y * DOT_SIZE,
+			r.width * DOT_SIZE, r.height * DOT_SIZE);
+	}
 }
 
 void X11Graphics::SetBrightness(int b)
@@ -136,6 +187,9 @@ int X11Graphics::GetKeyPress()
          if (event.type == KeyPress) {
              key = XLookupKeysym(&event.xkey, 0);
          }
+         else if (event.type == Expose) {
+             exposed = true;
+         }
     }
     return key;
 }
@@ -151,6 +151,34 @@ void Text::DrawMask(Canvas& canvas, Point pos, Color c) const
 	}
 }
 
+void Text::Draw(Canvas& canvas, Point pos, Color c, BlendMode mode) const
+{
+	if(text.IsEmpty() || (font == nullptr))
+		return;
+
+	const Image& img = font->GetImage();
+	if(img.HasColors())
+	{
+		for(const TextChar& tc : chars)
+			canvas.DrawColorImage(tc.position.Offset(pos.x, pos.y), img, mode, tc.imgrect);
+	}
+	else
+	{
+		for(const TextChar& tc : chars)
+			canvas.DrawMonoImage(tc.position.Offset(pos.x, pos.y), img, c, mode, tc.imgrect);
+	}
+}
+
+void Text::Draw(BitMask& mask, Point pos, byte threshold) const
+{
+	if(text.IsEmpty() || (font == nullptr))
+		return;
+
+	const Image& img = font->GetImage();
+	for(const TextChar& tc : chars)
+		mask.DrawImage(tc.position.Offset(pos.x, pos.y), img, tc.imgrect, threshold);
+}
+
 void Text::DrawTexturedOpaque(Canvas& canvas, Point pos, const IImage& tex, Point texoffset) const
 {
 	if(text.IsEmpty() || (font == nullptr))
@@ -279,3 +307,16 @@ void Text::DrawOutlineBlend(Canvas& canvas, Point pos, int distance, Color c) co
 	DrawBlend(canvas, Point(pos.x, pos.y - distance), c);
 	DrawBlend(canvas, Point(pos.x + diagdist, pos.y - diagdist), c);
 }
+
+void Text::DrawOutline(BitMask& mask, Point pos, int distance, byte threshold) const
+{
+	int diagdist = (distance > 1) ? distance - 1 : distance;
+	Draw(mask, Point(pos.x + distance, pos.y), threshold);
+	Draw(mask, Point(pos.x + diagdist, pos.y + diagdist), threshold);
+	Draw(mask, Point(pos.x, pos.y + distance), threshold);
+	Draw(mask, Point(pos.x - diagdist, pos.y + diagdist), threshold);
+	Draw(mask, Point(pos.x - distance, pos.y), threshold);
+	Draw(mask, Point(pos.x - diagdist, pos.y - diagdist), threshold);
+	Draw(mask, Point(pos.x, pos.y - distance), threshold);
+	Draw(mask, Point(pos.x + diagdist, pos.y - diagdist), threshold);
+}